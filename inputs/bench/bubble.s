@@ -0,0 +1,37 @@
+# bubble: bubble sort 16 words at 0x10010000 in place
+#   x[0] = 11, x[i+1] = (5 * x[i] + 3) & 0xff; $s3 = number of swaps
+	lui   $s0, 0x1001
+	li    $t5, 16
+	li    $t2, 11
+	li    $t0, 0
+	move  $t1, $s0
+gen:
+	sw    $t2, 0($t1)
+	sll   $t3, $t2, 2
+	addu  $t2, $t3, $t2
+	addiu $t2, $t2, 3
+	andi  $t2, $t2, 0xff
+	addiu $t1, $t1, 4
+	addiu $t0, $t0, 1
+	bne   $t0, $t5, gen
+	addiu $t7, $t5, -1
+outer:
+	li    $t6, 0
+	li    $t0, 0
+	move  $t1, $s0
+inner:
+	lw    $t2, 0($t1)
+	lw    $t3, 4($t1)
+	slt   $t4, $t3, $t2
+	beq   $t4, $zero, noswap
+	sw    $t3, 0($t1)
+	sw    $t2, 4($t1)
+	li    $t6, 1
+	addiu $s3, $s3, 1
+noswap:
+	addiu $t1, $t1, 4
+	addiu $t0, $t0, 1
+	bne   $t0, $t7, inner
+	bne   $t6, $zero, outer
+	li    $v0, 10
+	syscall
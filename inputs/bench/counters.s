@@ -0,0 +1,25 @@
+# counters: four cores run this program, each with its core ID in $k0; each
+# bumps a counter on its own line at 0x10010100 + 16 * ID 200 times, and
+# each time stores 7 to and reloads the word at 0x10010000, a line every core
+# writes; the results do not depend on how the cores interleave
+	lui $s0, 0x1001		# shared line
+	sll $t0, $k0, 4
+	addu $s1, $s0, $t0
+	addiu $s1, $s1, 0x100	# this core's private line
+	li $t1, 7
+	addiu $t2, $k0, 1	# stored to the shared word alongside 7
+	li $s2, 0		# sum of the shared reloads
+	li $s3, 200
+loop:
+	lw $t3, 0($s1)
+	addiu $t3, $t3, 1
+	sw $t3, 0($s1)
+	sw $t1, 0($s0)
+	lw $t4, 0($s0)
+	addu $s2, $s2, $t4
+	addiu $s3, $s3, -1
+	bgtz $s3, loop
+	sw $s2, 4($s1)
+	sw $t2, 8($s1)
+	li $v0, 10
+	syscall
@@ -0,0 +1,46 @@
+# heapsum: self-checking workload built on the SPIM syscalls
+#   sbrk a 64-word array, fill it with i*i, sum it into $s1, print
+#   "sum=<n>" and exit (syscall 17) with code 0 when the sum is 85344
+	li    $a0, 256
+	li    $v0, 9
+	syscall
+	move  $s0, $v0
+	li    $t0, 0
+	li    $t1, 64
+fill:
+	mult  $t0, $t0
+	mflo  $t2
+	sll   $t3, $t0, 2
+	addu  $t3, $s0, $t3
+	sw    $t2, 0($t3)
+	addiu $t0, $t0, 1
+	bne   $t0, $t1, fill
+	li    $s1, 0
+	li    $t0, 0
+sum:
+	sll   $t3, $t0, 2
+	addu  $t3, $s0, $t3
+	lw    $t2, 0($t3)
+	addu  $s1, $s1, $t2
+	addiu $t0, $t0, 1
+	bne   $t0, $t1, sum
+	lui   $s2, 0x1001
+	lui   $t2, 0x3d6d
+	ori   $t2, $t2, 0x7573
+	sw    $t2, 0($s2)
+	sw    $zero, 4($s2)
+	move  $a0, $s2
+	li    $v0, 4
+	syscall
+	move  $a0, $s1
+	li    $v0, 1
+	syscall
+	li    $a0, 10
+	li    $v0, 11
+	syscall
+	lui   $t4, 0x1
+	ori   $t4, $t4, 0x4d60
+	xor   $a0, $s1, $t4
+	sltu  $a0, $zero, $a0
+	li    $v0, 17
+	syscall
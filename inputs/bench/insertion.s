@@ -0,0 +1,38 @@
+# insertion: insertion sort 16 words at 0x10010000 in place
+#   x[0] = 29, x[i+1] = (5 * x[i] + 3) & 0xff; $s3 = number of element moves
+	lui   $s0, 0x1001
+	li    $t5, 16
+	li    $t2, 29
+	li    $t0, 0
+	move  $t1, $s0
+gen:
+	sw    $t2, 0($t1)
+	sll   $t3, $t2, 2
+	addu  $t2, $t3, $t2
+	addiu $t2, $t2, 3
+	andi  $t2, $t2, 0xff
+	addiu $t1, $t1, 4
+	addiu $t0, $t0, 1
+	bne   $t0, $t5, gen
+	li    $t0, 1
+outer:
+	sll   $t1, $t0, 2
+	addu  $t1, $s0, $t1
+	lw    $t2, 0($t1)
+	move  $t3, $t0
+shift:
+	beq   $t3, $zero, place
+	lw    $t4, -4($t1)
+	slt   $t6, $t2, $t4
+	beq   $t6, $zero, place
+	sw    $t4, 0($t1)
+	addiu $s3, $s3, 1
+	addiu $t1, $t1, -4
+	addiu $t3, $t3, -1
+	b     shift
+place:
+	sw    $t2, 0($t1)
+	addiu $t0, $t0, 1
+	bne   $t0, $t5, outer
+	li    $v0, 10
+	syscall
@@ -0,0 +1,69 @@
+# interp: bytecode interpreter with a compare-and-branch dispatch chain
+#   bytecode at 0x10010000 as {op, arg} word pairs:
+#     0 halt, 1 acc += arg, 2 acc ^= arg, 3 cnt = arg,
+#     4 if (--cnt != 0) goto arg, 5 acc = (acc << 1) & 0xffff
+#   program: cnt = 20; L1: acc += 3; acc ^= 0x55; acc <<= 1; acc += 7; loop L1; halt
+#   $s3 = acc, $s4 = bytecodes executed
+	lui   $s0, 0x1001
+	li    $t0, 3
+	sw    $t0, 0($s0)
+	li    $t0, 20
+	sw    $t0, 4($s0)
+	li    $t0, 1
+	sw    $t0, 8($s0)
+	li    $t0, 3
+	sw    $t0, 12($s0)
+	li    $t0, 2
+	sw    $t0, 16($s0)
+	li    $t0, 0x55
+	sw    $t0, 20($s0)
+	li    $t0, 5
+	sw    $t0, 24($s0)
+	sw    $zero, 28($s0)
+	li    $t0, 1
+	sw    $t0, 32($s0)
+	li    $t0, 7
+	sw    $t0, 36($s0)
+	li    $t0, 4
+	sw    $t0, 40($s0)
+	li    $t0, 1
+	sw    $t0, 44($s0)
+	sw    $zero, 48($s0)
+	sw    $zero, 52($s0)
+	li    $t1, 0
+dispatch:
+	sll   $t2, $t1, 3
+	addu  $t2, $s0, $t2
+	lw    $t3, 0($t2)
+	lw    $t4, 4($t2)
+	addiu $s4, $s4, 1
+	addiu $t1, $t1, 1
+	beq   $t3, $zero, halt
+	li    $t5, 1
+	beq   $t3, $t5, op_add
+	li    $t5, 2
+	beq   $t3, $t5, op_xor
+	li    $t5, 3
+	beq   $t3, $t5, op_set
+	li    $t5, 4
+	beq   $t3, $t5, op_loop
+	sll   $s3, $s3, 1
+	andi  $s3, $s3, 0xffff
+	b     dispatch
+op_add:
+	addu  $s3, $s3, $t4
+	b     dispatch
+op_xor:
+	xor   $s3, $s3, $t4
+	b     dispatch
+op_set:
+	move  $s6, $t4
+	b     dispatch
+op_loop:
+	addiu $s6, $s6, -1
+	beq   $s6, $zero, dispatch
+	move  $t1, $t4
+	b     dispatch
+halt:
+	li    $v0, 10
+	syscall
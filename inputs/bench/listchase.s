@@ -0,0 +1,30 @@
+# listchase: 32 nodes of 16 bytes at 0x10010000, node i = {next, value}
+#   next(i) = node (i + 13) mod 32, value(i) = 7*i + 1
+#   walk 128 hops from node 0: $s3 = sum of values, $s4 = hops, $s5 = last node
+	lui   $s0, 0x1001
+	li    $t5, 32
+	li    $t0, 0
+build:
+	addiu $t1, $t0, 13
+	andi  $t1, $t1, 31
+	sll   $t1, $t1, 4
+	addu  $t1, $s0, $t1
+	sll   $t2, $t0, 4
+	addu  $t2, $s0, $t2
+	sw    $t1, 0($t2)
+	sll   $t3, $t0, 3
+	subu  $t3, $t3, $t0
+	addiu $t3, $t3, 1
+	sw    $t3, 4($t2)
+	addiu $t0, $t0, 1
+	bne   $t0, $t5, build
+	move  $s5, $s0
+	li    $t6, 128
+walk:
+	lw    $t3, 4($s5)
+	addu  $s3, $s3, $t3
+	lw    $s5, 0($s5)
+	addiu $s4, $s4, 1
+	bne   $s4, $t6, walk
+	li    $v0, 10
+	syscall
@@ -0,0 +1,59 @@
+# matmul: C = A * B for 4x4 word matrices (row-major)
+#   A[i][j] = i + j + 1, B[i][j] = i - j
+#   A at 0x10010000, B at 0x10010040, C at 0x10010080, $s3 = sum of C
+	lui   $s0, 0x1001
+	addiu $s1, $s0, 64
+	addiu $s2, $s0, 128
+	li    $t5, 4
+	li    $t0, 0
+init_i:
+	li    $t1, 0
+init_j:
+	sll   $t2, $t0, 2
+	addu  $t2, $t2, $t1
+	sll   $t2, $t2, 2
+	addu  $t3, $s0, $t2
+	addu  $t4, $t0, $t1
+	addiu $t4, $t4, 1
+	sw    $t4, 0($t3)
+	addu  $t3, $s1, $t2
+	subu  $t4, $t0, $t1
+	sw    $t4, 0($t3)
+	addiu $t1, $t1, 1
+	bne   $t1, $t5, init_j
+	addiu $t0, $t0, 1
+	bne   $t0, $t5, init_i
+	li    $t0, 0
+mm_i:
+	li    $t1, 0
+mm_j:
+	li    $t6, 0
+	li    $t7, 0
+mm_k:
+	sll   $t2, $t0, 2
+	addu  $t2, $t2, $t7
+	sll   $t2, $t2, 2
+	addu  $t2, $s0, $t2
+	lw    $t3, 0($t2)
+	sll   $t2, $t7, 2
+	addu  $t2, $t2, $t1
+	sll   $t2, $t2, 2
+	addu  $t2, $s1, $t2
+	lw    $t4, 0($t2)
+	mult  $t3, $t4
+	mflo  $t8
+	addu  $t6, $t6, $t8
+	addiu $t7, $t7, 1
+	bne   $t7, $t5, mm_k
+	sll   $t2, $t0, 2
+	addu  $t2, $t2, $t1
+	sll   $t2, $t2, 2
+	addu  $t2, $s2, $t2
+	sw    $t6, 0($t2)
+	addu  $s3, $s3, $t6
+	addiu $t1, $t1, 1
+	bne   $t1, $t5, mm_j
+	addiu $t0, $t0, 1
+	bne   $t0, $t5, mm_i
+	li    $v0, 10
+	syscall
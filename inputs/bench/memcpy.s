@@ -0,0 +1,43 @@
+# memcpy: memset 64 words at 0x10010400 to 0xa5a5a5a5, fill 64 words at
+# 0x10010000 with 3*i + 7, copy them to 0x10010200, then sum the copy into $s3
+	lui   $s0, 0x1001
+	addiu $s1, $s0, 0x200
+	addiu $s2, $s0, 0x400
+	li    $t5, 64
+	li    $t6, 0xa5a5a5a5
+	move  $t0, $s2
+	li    $t1, 0
+memset:
+	sw    $t6, 0($t0)
+	addiu $t0, $t0, 4
+	addiu $t1, $t1, 1
+	bne   $t1, $t5, memset
+	move  $t0, $s0
+	li    $t1, 0
+	li    $t2, 7
+fill:
+	sw    $t2, 0($t0)
+	addiu $t2, $t2, 3
+	addiu $t0, $t0, 4
+	addiu $t1, $t1, 1
+	bne   $t1, $t5, fill
+	move  $t0, $s0
+	move  $t3, $s1
+	li    $t1, 0
+copy:
+	lw    $t4, 0($t0)
+	sw    $t4, 0($t3)
+	addiu $t0, $t0, 4
+	addiu $t3, $t3, 4
+	addiu $t1, $t1, 1
+	bne   $t1, $t5, copy
+	move  $t3, $s1
+	li    $t1, 0
+sum:
+	lw    $t4, 0($t3)
+	addu  $s3, $s3, $t4
+	addiu $t3, $t3, 4
+	addiu $t1, $t1, 1
+	bne   $t1, $t5, sum
+	li    $v0, 10
+	syscall
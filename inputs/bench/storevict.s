@@ -0,0 +1,29 @@
+# storevict: for 8 lines at 0x10010000, load the line, evict it with a load
+# from the same cache index 0x100 bytes up, then store to it (SB, SH, SW)
+# while it is held behind L1 and reload it; the sum of the reloads lands in $s3
+	lui   $s0, 0x1001
+	li    $t5, 8
+	li    $t1, 0
+	move  $t3, $s0
+	li    $t6, 0x77
+loop:
+	lw    $t0, 0($t3)
+	lw    $t0, 0x100($t3)
+	sb    $t6, 0($t3)
+	sh    $t6, 10($t3)
+	sw    $t6, 4($t3)
+	lw    $t0, 0x100($t3)
+	sw    $t3, 12($t3)
+	lw    $t0, 0x100($t3)
+	lw    $t4, 12($t3)
+	addu  $s3, $s3, $t4
+	lw    $t4, 0($t3)
+	addu  $s3, $s3, $t4
+	lw    $t4, 8($t3)
+	addu  $s3, $s3, $t4
+	addiu $t6, $t6, 0x11
+	addiu $t3, $t3, 16
+	addiu $t1, $t1, 1
+	bne   $t1, $t5, loop
+	li    $v0, 10
+	syscall
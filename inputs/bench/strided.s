@@ -0,0 +1,37 @@
+# strided: 256 words at 0x10010000 hold x[i] = i; sum them twice with
+# word strides 1, 4 and 16 into $s3, $s4 and $s5
+	lui   $s0, 0x1001
+	li    $t5, 256
+	li    $t0, 0
+	move  $t1, $s0
+init:
+	sw    $t0, 0($t1)
+	addiu $t1, $t1, 4
+	addiu $t0, $t0, 1
+	bne   $t0, $t5, init
+	addiu $t9, $s0, 1024
+	li    $t7, 2
+	li    $t8, 0
+pass:
+	move  $t1, $s0
+s1:
+	lw    $t2, 0($t1)
+	addu  $s3, $s3, $t2
+	addiu $t1, $t1, 4
+	bne   $t1, $t9, s1
+	move  $t1, $s0
+s4:
+	lw    $t2, 0($t1)
+	addu  $s4, $s4, $t2
+	addiu $t1, $t1, 16
+	bne   $t1, $t9, s4
+	move  $t1, $s0
+s16:
+	lw    $t2, 0($t1)
+	addu  $s5, $s5, $t2
+	addiu $t1, $t1, 64
+	bne   $t1, $t9, s16
+	addiu $t8, $t8, 1
+	bne   $t8, $t7, pass
+	li    $v0, 10
+	syscall
@@ -0,0 +1,91 @@
+#!/bin/sh
+# Run every benchmark workload in a directory and check it against its expectations.
+#
+# Usage: ./bench.sh [bench dir] [max cycles] [mode]
+#
+# mode is a comma-separated list of <param>=<value> passed to the simulator
+# with -s; "-" (the default) runs the scalar pipeline as configured at start.
+#
+# Each workload is a <name>.in program with a <name>.expect file next to it:
+#   reg <n> <value>      -- GPR <n> must hold <value> when the program stops
+#   mem <addr> <value>   -- the word at <addr> must hold <value>
+# Lines starting with '#' are comments. A <name>.out file, when present, must
+# match what the program printed through its print syscalls. A <name>.opts
+# file holds more <param>=<value> items in the same form as mode, applied
+# after it (e.g. cores=4,quantum=1 for a multi-core workload).
+# Exits non-zero when any workload fails.
+
+SIM=./mu-mips
+DIR=${1:-../inputs/bench}
+MAX_CYCLES=${2:-2000000}
+MODE=${3:--}
+failed=0
+
+params=
+[ "$MODE" = "-" ] || for p in $(echo "$MODE" | tr ',' ' '); do
+	params="$params -s $p"
+done
+
+echo "mode: $MODE"
+
+printf "%-12s %-6s %10s %10s %7s %7s %14s\n" "workload" "result" "cycles" "instrs" "CPI" "miss%" "host cycles/s"
+for prog in "$DIR"/*.in; do
+	name=$(basename "$prog" .in)
+	expect="$DIR/$name.expect"
+	[ -f "$expect" ] || continue
+	out="$DIR/$name.out"
+	guest=
+	[ -f "$out" ] && guest=$(mktemp)
+	opts=
+	[ -f "$DIR/$name.opts" ] && for p in $(tr ',' ' ' < "$DIR/$name.opts"); do
+		opts="$opts -s $p"
+	done
+
+	# sim is bounded by run so a hung workload cannot stall the whole suite
+	{
+		echo "run $MAX_CYCLES"
+		echo "rdump"
+		awk '$1 == "mem" { print "mdump " $2 " " $2 }' "$expect"
+		echo "perf"
+		echo "quit"
+	} | $SIM -b $params $opts ${guest:+-o "$guest"} -x /dev/stdin "$prog" 2>&1 | awk -v name="$name" -v expect="$expect" -v out="$guest" -v want="$out" '
+		/^\[R[0-9]+\]/ { r = substr($1, 3, length($1) - 3); reg[r] = $3 }
+		/^\t0x[0-9a-f]+ \([0-9]+\) :/ { mem[$1] = $4 }
+		/^cycles\t/ { cycles = $3 }
+		/^instructions\t/ { insts = $3 }
+		/^cache\.hits\t/ { hits = $3 }
+		/^cache\.misses\t/ { misses = $3 }
+		/^\[host\] / { for (i = 1; i <= NF; i++) if ($i == "cycles/s,") rate = $(i - 1) }
+		END {
+			bad = 0
+			while ((getline line < expect) > 0) {
+				split(line, f, " ")
+				if (f[1] == "reg" && tolower(reg[f[2]]) != tolower(f[3])) {
+					if (bad++ < 3)
+						printf("  %s: R%s = %s, expected %s\n", name, f[2], reg[f[2]], f[3]) > "/dev/stderr"
+				}
+				if (f[1] == "mem" && tolower(mem[f[2]]) != tolower(f[3])) {
+					if (bad++ < 3)
+						printf("  %s: [%s] = %s, expected %s\n", name, f[2], mem[f[2]], f[3]) > "/dev/stderr"
+				}
+			}
+			if (out != "") {
+				while ((getline line < want) > 0) {
+					if ((getline got < out) <= 0 || got != line) {
+						bad++
+						printf("  %s: guest printed \"%s\", expected \"%s\"\n", name, got, line) > "/dev/stderr"
+						break
+					}
+				}
+			}
+			if (bad > 3)
+				printf("  %s: ... %d more mismatches\n", name, bad - 3) > "/dev/stderr"
+			acc = hits + misses
+			printf("%-12s %-6s %10d %10d %7.3f %7.2f %14s\n", name, bad ? "FAIL" : "PASS", cycles, insts,
+				insts ? cycles / insts : 0, acc ? 100 * misses / acc : 0, rate)
+			exit bad ? 1 : 0
+		}' || failed=$((failed + 1))
+	[ -z "$guest" ] || rm -f "$guest"
+done
+
+[ $failed -eq 0 ] || { echo "$failed workload(s) failed"; exit 1; }
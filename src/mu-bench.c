@@ -0,0 +1,198 @@
+/******************************************************************************/
+/* MU-MIPS microbenchmarks: times the simulator's hot functions in isolation  */
+/*                                                                            */
+/* Usage: mu-bench [-r reps] [-n iters] [-w warmup] [-o file.csv]             */
+/*                                                                            */
+/* Every benchmark runs <warmup> untimed repetitions, then <reps> timed ones  */
+/* of <iters> calls each. One CSV row per benchmark reports ns per call.      */
+/* With -o the rows are appended to the file, so runs accumulate over time.   */
+/******************************************************************************/
+#define MU_MIPS_NO_MAIN
+#include "mu-mips.c"
+
+#include <unistd.h>
+
+#define BENCH_PROGRAM_WORDS 1024
+#define BENCH_DATA_WORDS    4096
+
+typedef struct Bench_Struct {
+	const char *name;
+	void (*setup)();
+	void (*body)(uint32_t i);
+} Bench;
+
+volatile uint32_t bench_sink; // keeps results of pure calls alive
+
+/***************************************************************/
+/* Setups                                                      */
+/***************************************************************/
+void setup_none() {
+}
+
+/* Warm every line the hit benchmark touches */
+void setup_cache_warm() {
+	uint32_t i;
+	for (i = 0; i < NUM_CACHE_BLOCKS; i++) {
+		cache_load_32(MEM_DATA_BEGIN + (i << 4));
+	}
+	MEM_STALL_CYCLES = 0;
+}
+
+/* A text segment of independent ALU instructions so cycle() runs without hazards */
+void setup_pipeline() {
+	uint32_t i, rd, rs;
+	for (i = 0; i < BENCH_PROGRAM_WORDS; i++) {
+		rd = 8 + (i % 8);
+		rs = 16 + (i % 8);
+		mem_write_32(MEM_TEXT_BEGIN + (i << 2), (rs << 21) | (rs << 16) | (rd << 11) | 0x21); // ADDU rd, rs, rs
+	}
+	PROGRAM_SIZE = BENCH_PROGRAM_WORDS;
+	profile_reset();
+	CURRENT_STATE.PC = MEM_TEXT_BEGIN;
+	NEXT_STATE = CURRENT_STATE;
+	RUN_FLAG = TRUE;
+	pipeline_select(); // as run() does
+}
+
+/***************************************************************/
+/* Bodies                                                      */
+/***************************************************************/
+void body_mem_read_32(uint32_t i) {
+	bench_sink = mem_read_32(MEM_DATA_BEGIN + ((i % BENCH_DATA_WORDS) << 2));
+}
+
+void body_mem_write_32(uint32_t i) {
+	mem_write_32(MEM_DATA_BEGIN + ((i % BENCH_DATA_WORDS) << 2), i);
+}
+
+void body_cache_isHit_hit(uint32_t i) {
+	bench_sink = cache_isHit(MEM_DATA_BEGIN + ((i % NUM_CACHE_BLOCKS) << 4));
+}
+
+void body_cache_isHit_miss(uint32_t i) {
+	bench_sink = cache_isHit(MEM_DATA_BEGIN + 0x10000 + ((i % NUM_CACHE_BLOCKS) << 4));
+}
+
+void body_cache_load_32(uint32_t i) {
+	bench_sink = cache_load_32(MEM_DATA_BEGIN + ((i % BENCH_DATA_WORDS) << 2));
+	MEM_STALL_CYCLES = 0;
+}
+
+void body_cycle(uint32_t i) {
+	if (CURRENT_STATE.PC >= MEM_TEXT_BEGIN + (BENCH_PROGRAM_WORDS << 2) - 16) {
+		CURRENT_STATE.PC = MEM_TEXT_BEGIN;
+		NEXT_STATE.PC = MEM_TEXT_BEGIN;
+	}
+	cycle();
+}
+
+void body_print_instruction(uint32_t i) {
+	print_instruction(MEM_TEXT_BEGIN + ((i % BENCH_PROGRAM_WORDS) << 2));
+}
+
+Bench BENCHES[] = {
+	{ "mem_read_32", setup_none, body_mem_read_32 },
+	{ "mem_write_32", setup_none, body_mem_write_32 },
+	{ "cache_isHit_hit", setup_cache_warm, body_cache_isHit_hit },
+	{ "cache_isHit_miss", setup_cache_warm, body_cache_isHit_miss },
+	{ "cache_load_32", setup_none, body_cache_load_32 },
+	{ "cycle", setup_pipeline, body_cycle },
+	{ "print_instruction", setup_pipeline, body_print_instruction },
+};
+
+#define NUM_BENCHES (sizeof(BENCHES) / sizeof(BENCHES[0]))
+
+int compare_double(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of a sorted sample */
+double percentile(double *sorted, int n, double p) {
+	int rank = (int)(p / 100.0 * n + 0.999999);
+	if (rank < 1) {
+		rank = 1;
+	}
+	return sorted[rank > n ? n - 1 : rank - 1];
+}
+
+/***************************************************************/
+/* main                                                        */
+/***************************************************************/
+int main(int argc, char *argv[]) {
+	int reps = 30, warmup = 5, opt, r, b, write_header;
+	uint32_t iters = 100000, i;
+	const char *csv_path = NULL;
+	double *samples, mean;
+	uint64_t t0;
+	FILE *csv;
+	int csv_fd;
+
+	while ((opt = getopt(argc, argv, "r:n:w:o:")) != -1) {
+		switch (opt) {
+			case 'r': reps = atoi(optarg); break;
+			case 'n': iters = strtoul(optarg, NULL, 0); break;
+			case 'w': warmup = atoi(optarg); break;
+			case 'o': csv_path = optarg; break;
+			default:
+				fprintf(stderr, "Usage: %s [-r reps] [-n iters] [-w warmup] [-o file.csv]\n", argv[0]);
+				exit(1);
+		}
+	}
+	if (reps < 1 || iters < 1) {
+		fprintf(stderr, "reps and iters must be positive\n");
+		exit(1);
+	}
+
+	/* The simulator traces to stdout; keep the real stdout for CSV and silence the rest */
+	if (csv_path) {
+		csv = fopen(csv_path, "a");
+		if (csv == NULL) {
+			fprintf(stderr, "Error: can't open %s\n", csv_path);
+			exit(1);
+		}
+	}
+	else {
+		csv_fd = dup(fileno(stdout));
+		csv = fdopen(csv_fd, "w");
+	}
+	write_header = csv_path == NULL || ftell(csv) == 0;
+	if (freopen("/dev/null", "w", stdout) == NULL) {
+		fprintf(stderr, "Error: can't silence simulator output\n");
+		exit(1);
+	}
+
+	initialize();
+	samples = malloc(reps * sizeof(double));
+
+	if (write_header) {
+		fprintf(csv, "timestamp,benchmark,reps,iters,min_ns,p50_ns,p90_ns,p99_ns,max_ns,mean_ns\n");
+	}
+	for (b = 0; b < NUM_BENCHES; b++) {
+		BENCHES[b].setup();
+		for (r = 0; r < warmup; r++) {
+			for (i = 0; i < iters; i++) {
+				BENCHES[b].body(i);
+			}
+		}
+		mean = 0;
+		for (r = 0; r < reps; r++) {
+			t0 = host_now_ns();
+			for (i = 0; i < iters; i++) {
+				BENCHES[b].body(i);
+			}
+			samples[r] = (double)(host_now_ns() - t0) / iters;
+			mean += samples[r];
+		}
+		mean /= reps;
+		qsort(samples, reps, sizeof(double), compare_double);
+		fprintf(csv, "%ld,%s,%d,%u,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n", (long)time(NULL), BENCHES[b].name, reps, iters,
+			samples[0], percentile(samples, reps, 50), percentile(samples, reps, 90),
+			percentile(samples, reps, 99), samples[reps - 1], mean);
+		fflush(csv);
+	}
+
+	free(samples);
+	fclose(csv);
+	return 0;
+}
@@ -21,19 +21,39 @@ typedef struct Cache_Struct {
 } Cache;
 
 // Write buffer for store instructions
-uint32_t write_buffer[WORD_PER_BLOCK]; 
+CORE_LOCAL uint32_t write_buffer[WORD_PER_BLOCK]; 
 
 /***************************************************************/
 /* CACHE STATS                                                 */
 /***************************************************************/
-uint32_t cache_misses; //need to initialize to 0 at the beginning of simulation start
-uint32_t cache_hits;   //need to initialize to 0 at the beginning of simulation start
+CORE_LOCAL uint32_t cache_misses; //need to initialize to 0 at the beginning of simulation start
+CORE_LOCAL uint32_t cache_hits;   //need to initialize to 0 at the beginning of simulation start
+uint32_t CACHE_MISS_PENALTY; // cycles the pipeline is frozen for every line fill (0 = ideal memory)
+CORE_LOCAL uint32_t MEM_STALL_CYCLES;   // cycles left on the line fill in flight
 
 
 /***************************************************************/
 /* CACHE OBJECT                                                */
 /***************************************************************/
-Cache L1Cache; //need to use this in the simulator 
+CORE_LOCAL Cache L1Cache; //need to use this in the simulator 
+
+/* Victim/miss cache behind L1 (mu-victim.h) */
+extern uint32_t VICTIM_ENTRIES;
+int victim_lookup(uint32_t addr);
+void victim_evict(uint32_t index);
+void victim_fill(uint32_t index);
+void victim_write(uint32_t addr, uint32_t value);
+
+/* Host-parallel cores (mu-multicore.h): held while this core's L1 tags change */
+void tags_lock();
+void tags_unlock();
+
+/* Non-blocking fills (mu-mshr.h) */
+extern uint32_t MSHR_COUNT;
+
+/* Main memory timing (mu-dram.h) */
+extern int DRAM_ENABLED;
+uint32_t mem_fill_latency(uint32_t addr, uint32_t now);
 
 // Already assume when calling this that the address is in the cache. 
 // So just decode and return 
@@ -41,7 +61,7 @@ uint32_t cache_read_32(uint32_t addr) {
 	uint32_t index = (addr & 0x000000F0) >> 4;
 	uint32_t word_offset = (addr & 0x0000000C) >> 2;
  	uint32_t value = L1Cache.blocks[index].words[word_offset];
-	printf("Cache read index: %u\tword offset: %u\tvalue: %u\n", index, word_offset, value);
+	TRACE("Cache read index: %u\tword offset: %u\tvalue: %u\n", index, word_offset, value);
 	return value;
 }
 
@@ -56,32 +76,48 @@ int cache_isHit(uint32_t addr) {
 	for(i=0; i<NUM_CACHE_BLOCKS; i++) {
 		if( (L1Cache.blocks[index].tag == tag) && (1 == L1Cache.blocks[index].valid) ) // Tags match & Valid
 		{ 
-			printf("HIT!!!~!~!\n");
+			TRACE("HIT!!!~!~!\n");
 			cache_hits++;
 			return 1; // hit
 		}
 
 	}
+	if (VICTIM_ENTRIES && victim_lookup(addr)) {
+		TRACE("VICTIM HIT\n");
+		cache_hits++;
+		return 1;
+	}
 	cache_misses++; 
-	printf("MISSSS!!!~!~!\n");
+	TRACE("MISSSS!!!~!~!\n");
 	return 0; // miss
 }
 
 // Call this on cache *miss*, load cache line from addr, and return the appropriate word
 uint32_t cache_load_32(uint32_t addr) { 
-	printf("Address: %u\n", addr);
+	TRACE("Address: %u\n", addr);
 	uint32_t index = (addr & 0x000000F0) >> 4; // Block number
 	uint32_t tag = (addr & 0xFFFFFF00) >> 8;
 	uint32_t word_offset = (addr & 0x0000000C) >> 2;
 	int i=0;
+	if (VICTIM_ENTRIES) {
+		victim_evict(index);
+	}
 	for(i=0; i<WORD_PER_BLOCK; i++) {
 		uint32_t load_addr = (addr & 0xFFFFFFF0) + (i*4);
-		L1Cache.blocks[index].tag = tag;
-		L1Cache.blocks[index].valid = 1;
 		L1Cache.blocks[index].words[i] = mem_read_32(load_addr);
 	}
+	tags_lock();
+	L1Cache.blocks[index].tag = tag;
+	L1Cache.blocks[index].valid = 1;
+	tags_unlock();
+	if (MSHR_COUNT == 0) { // with MSHRs the fill is tracked by mshr_access() instead
+		MEM_STALL_CYCLES += mem_fill_latency(addr, CYCLE_COUNT);
+	}
+	if (VICTIM_ENTRIES) {
+		victim_fill(index);
+	}
 	// Return word that resulted in cache miss
-	printf("Cache line: %8x\tindex: %u,\tword_offset: %u\n", L1Cache.blocks[index].words[word_offset], index, word_offset);
+	TRACE("Cache line: %8x\tindex: %u,\tword_offset: %u\n", L1Cache.blocks[index].words[word_offset], index, word_offset);
 	return L1Cache.blocks[index].words[word_offset];
 }
 
@@ -90,5 +126,20 @@ void cache_write_32(uint32_t addr, uint32_t value) {
 	uint32_t index = (addr & 0x000000F0) >> 4;
 	uint32_t word_offset = (addr & 0x0000000C) >> 2;
 	L1Cache.blocks[index].words[word_offset] = value;
-	printf("Cache write index: %u\tword offset: %u\tvalue: %u\n", index, word_offset, value);
+	if (VICTIM_ENTRIES) {
+		victim_write(addr, value);
+	}
+	TRACE("Cache write index: %u\tword offset: %u\tvalue: %u\n", index, word_offset, value);
+}
+
+// SB/SH write the merged word to memory directly; bring any copy of the line in or behind L1 along
+void cache_update_32(uint32_t addr, uint32_t value) {
+	uint32_t index = (addr & 0x000000F0) >> 4;
+	uint32_t tag = (addr & 0xFFFFFF00) >> 8;
+	if (L1Cache.blocks[index].valid && L1Cache.blocks[index].tag == tag) {
+		cache_write_32(addr, value);
+	}
+	else if (VICTIM_ENTRIES) {
+		victim_write(addr, value);
+	}
 }
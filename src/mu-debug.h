@@ -0,0 +1,187 @@
+/******************************************************************************/
+/* BREAKPOINTS AND WATCHPOINTS                                                */
+/******************************************************************************/
+#define WATCH_PAGE_BITS 12                          // 4 KB watch pages
+#define WATCH_NUM_PAGES (1u << (32 - WATCH_PAGE_BITS))
+#define MAX_WATCHPOINTS 64
+#define BREAK_NONE      0xFFFFFFFF
+
+#define WATCH_READ  1
+#define WATCH_WRITE 2
+
+typedef struct Watchpoint_Struct {
+	uint32_t addr;  // word address
+	int kind;       // WATCH_READ | WATCH_WRITE
+} Watchpoint;
+
+/* PC breakpoints: one bit per word of the loaded text segment */
+uint64_t *BREAK_BITMAP;
+uint32_t BREAK_BITMAP_WORDS;    // text words the bitmap covers
+uint32_t BREAK_COUNT;
+
+/* Data watchpoints: a flag per page, then a short list for the pages that have one */
+uint8_t WATCH_PAGES[WATCH_NUM_PAGES];
+Watchpoint WATCHPOINTS[MAX_WATCHPOINTS];
+uint32_t WATCH_COUNT;
+
+int BREAK_ACTIVE;               // any breakpoint or watchpoint set; the only test run() makes per cycle
+uint32_t BREAK_STOPPED_PC = BREAK_NONE; // PC of the last breakpoint stop, so resuming steps past it
+uint32_t WATCH_HIT_ADDR, WATCH_HIT_PC;
+int WATCH_HIT;                  // kind of the pending watchpoint hit, 0 = none
+
+#define BREAK_INDEX(pc) (((pc) - MEM_TEXT_BEGIN) >> 2)
+
+// Called from MEM() with every data address; one page-flag test when nothing is watched there
+#define WATCH_CHECK(opcode, addr, pc) do { if (WATCH_PAGES[(addr) >> WATCH_PAGE_BITS]) watch_check((opcode), (addr), (pc)); } while (0)
+
+void break_update() {
+	BREAK_ACTIVE = (BREAK_COUNT + WATCH_COUNT) > 0;
+}
+
+/* Size the bitmap for the program now in memory, keeping breakpoints already set */
+void break_resize() {
+	uint32_t words = (PROGRAM_SIZE + 63) / 64;
+	if (words > BREAK_BITMAP_WORDS) {
+		BREAK_BITMAP = realloc(BREAK_BITMAP, words * sizeof(uint64_t));
+		memset(BREAK_BITMAP + BREAK_BITMAP_WORDS, 0, (words - BREAK_BITMAP_WORDS) * sizeof(uint64_t));
+		BREAK_BITMAP_WORDS = words;
+	}
+}
+
+int break_is_set(uint32_t pc) {
+	uint32_t index = BREAK_INDEX(pc);
+	return pc >= MEM_TEXT_BEGIN && index / 64 < BREAK_BITMAP_WORDS && (BREAK_BITMAP[index / 64] >> (index % 64)) & 1;
+}
+
+void break_set(uint32_t pc) {
+	uint32_t index = BREAK_INDEX(pc);
+	if (pc < MEM_TEXT_BEGIN || (pc & 3) || index >= PROGRAM_SIZE) {
+		printf("Breakpoint 0x%08x is outside the loaded text segment\n", pc);
+		return;
+	}
+	if (!break_is_set(pc)) {
+		BREAK_BITMAP[index / 64] |= 1ull << (index % 64);
+		BREAK_COUNT++;
+	}
+	break_update();
+	printf("Breakpoint at 0x%08x\n", pc);
+}
+
+void watch_set(uint32_t addr, int kind) {
+	uint32_t i;
+	addr &= ~3u;
+	for (i = 0; i < WATCH_COUNT; i++) {
+		if (WATCHPOINTS[i].addr == addr) {
+			WATCHPOINTS[i].kind = kind;
+			break;
+		}
+	}
+	if (i == WATCH_COUNT) {
+		if (WATCH_COUNT == MAX_WATCHPOINTS) {
+			printf("Too many watchpoints (max %d)\n", MAX_WATCHPOINTS);
+			return;
+		}
+		WATCHPOINTS[WATCH_COUNT].addr = addr;
+		WATCHPOINTS[WATCH_COUNT].kind = kind;
+		WATCH_COUNT++;
+		WATCH_PAGES[addr >> WATCH_PAGE_BITS]++;
+	}
+	break_update();
+	printf("Watchpoint (%s%s) at 0x%08x\n", kind & WATCH_READ ? "r" : "", kind & WATCH_WRITE ? "w" : "", addr);
+}
+
+/* Remove the breakpoint and watchpoint at addr */
+void break_delete(uint32_t addr) {
+	uint32_t i, index = BREAK_INDEX(addr);
+	if (break_is_set(addr)) {
+		BREAK_BITMAP[index / 64] &= ~(1ull << (index % 64));
+		BREAK_COUNT--;
+	}
+	for (i = 0; i < WATCH_COUNT; i++) {
+		if (WATCHPOINTS[i].addr == (addr & ~3u)) {
+			WATCH_PAGES[WATCHPOINTS[i].addr >> WATCH_PAGE_BITS]--;
+			WATCHPOINTS[i] = WATCHPOINTS[--WATCH_COUNT];
+			break;
+		}
+	}
+	break_update();
+}
+
+void break_delete_all() {
+	uint32_t i;
+	if (BREAK_BITMAP_WORDS) {
+		memset(BREAK_BITMAP, 0, BREAK_BITMAP_WORDS * sizeof(uint64_t));
+	}
+	for (i = 0; i < WATCH_COUNT; i++) {
+		WATCH_PAGES[WATCHPOINTS[i].addr >> WATCH_PAGE_BITS] = 0;
+	}
+	BREAK_COUNT = 0;
+	WATCH_COUNT = 0;
+	WATCH_HIT = 0;
+	break_update();
+}
+
+void break_list() {
+	uint32_t i;
+	printf("-------------------------------------------------------------\n");
+	printf("Breakpoints (%u)\n", BREAK_COUNT);
+	printf("-------------------------------------------------------------\n");
+	for (i = 0; i < BREAK_BITMAP_WORDS * 64; i++) {
+		if ((BREAK_BITMAP[i / 64] >> (i % 64)) & 1) {
+			printf("0x%08x\t", MEM_TEXT_BEGIN + (i << 2));
+			print_instruction(MEM_TEXT_BEGIN + (i << 2));
+		}
+	}
+	printf("-------------------------------------------------------------\n");
+	printf("Watchpoints (%u)\n", WATCH_COUNT);
+	printf("-------------------------------------------------------------\n");
+	for (i = 0; i < WATCH_COUNT; i++) {
+		printf("0x%08x\t%s%s\n", WATCHPOINTS[i].addr,
+			WATCHPOINTS[i].kind & WATCH_READ ? "r" : "", WATCHPOINTS[i].kind & WATCH_WRITE ? "w" : "");
+	}
+	printf("-------------------------------------------------------------\n");
+}
+
+/* Slow path of WATCH_CHECK: the page holds a watchpoint */
+void watch_check(uint32_t opcode, uint32_t addr, uint32_t pc) {
+	int kind;
+	uint32_t i;
+
+	switch (opcode) {
+		case 0x20: case 0x21: case 0x23: kind = WATCH_READ; break;   // LB, LH, LW
+		case 0x28: case 0x29: case 0x2B: kind = WATCH_WRITE; break;  // SB, SH, SW
+		default: return;
+	}
+	for (i = 0; i < WATCH_COUNT; i++) {
+		if (WATCHPOINTS[i].addr == (addr & ~3u) && (WATCHPOINTS[i].kind & kind)) {
+			WATCH_HIT = kind;
+			WATCH_HIT_ADDR = addr;
+			WATCH_HIT_PC = pc;
+			return;
+		}
+	}
+}
+
+/***************************************************************/
+/* Called after each cycle while BREAK_ACTIVE: TRUE to stop    */
+/***************************************************************/
+int break_check() {
+	uint32_t pc = CURRENT_STATE.PC;
+
+	if (WATCH_HIT) {
+		printf("Watchpoint: %s of 0x%08x by 0x%08x at cycle %u\n", WATCH_HIT == WATCH_READ ? "read" : "write",
+			WATCH_HIT_ADDR, WATCH_HIT_PC, CYCLE_COUNT);
+		WATCH_HIT = 0;
+		return TRUE;
+	}
+	if (pc == BREAK_STOPPED_PC) {
+		return FALSE;
+	}
+	BREAK_STOPPED_PC = BREAK_NONE;
+	if (break_is_set(pc)) {
+		printf("Breakpoint: fetching 0x%08x at cycle %u\n", pc, CYCLE_COUNT);
+		BREAK_STOPPED_PC = pc;
+		return TRUE;
+	}
+	return FALSE;
+}
@@ -0,0 +1,300 @@
+/******************************************************************************/
+/* DRAM TIMING MODEL: CHANNELS / RANKS / BANKS WITH AN FR-FCFS SCHEDULER      */
+/******************************************************************************/
+#define DRAM_MAX_CHANNELS 8
+#define DRAM_MAX_RANKS    4
+#define DRAM_MAX_BANKS    16
+#define DRAM_QUEUE_SIZE   32   // requests waiting per channel
+#define DRAM_ROW_LINES    128  // cache lines per 2 KB row
+#define DRAM_TBURST       4    // cycles a line occupies the channel's data bus
+
+typedef enum {
+	DRAM_OPEN_PAGE,   // leave the row open after an access
+	DRAM_CLOSED_PAGE  // precharge right after every access
+} dram_policy_t;
+
+typedef struct DRAM_Bank_Struct {
+	int open;           // a row is latched in the row buffer
+	uint32_t open_row;
+	uint32_t ready;     // cycle the bank accepts its next command
+} DRAM_Bank;
+
+typedef struct DRAM_Request_Struct {
+	uint32_t arrival;
+	uint32_t bank;      // rank * DRAM_BANKS + bank
+	uint32_t row;
+	int write;
+	uint32_t id;
+} DRAM_Request;
+
+typedef struct DRAM_Channel_Struct {
+	DRAM_Bank banks[DRAM_MAX_RANKS * DRAM_MAX_BANKS];
+	DRAM_Request queue[DRAM_QUEUE_SIZE];
+	uint32_t count;
+	uint32_t clock;     // command-bus time the scheduler has reached
+	uint32_t bus_free;  // cycle the data bus finishes its last burst
+	uint64_t bus_busy;  // data-bus cycles used
+} DRAM_Channel;
+
+int DRAM_ENABLED;
+dram_policy_t DRAM_POLICY;
+uint32_t DRAM_CHANNELS = 1, DRAM_RANKS = 1, DRAM_BANKS = 8;
+uint32_t DRAM_TRCD = 14, DRAM_TCAS = 14, DRAM_TRP = 14;
+DRAM_Channel DRAM[DRAM_MAX_CHANNELS];
+uint32_t DRAM_NEXT_ID;
+pthread_mutex_t DRAM_LOCK = PTHREAD_MUTEX_INITIALIZER; // cores on host threads share the channels
+
+/* Statistics */
+uint64_t DRAM_READS, DRAM_WRITES;
+uint64_t DRAM_ROW_HITS, DRAM_ROW_EMPTY, DRAM_ROW_CONFLICTS;
+uint64_t DRAM_READ_LATENCY;    // sum of read latencies, arrival to last data beat
+uint64_t DRAM_QUEUE_FULL;      // posts that had to drain a request first
+uint32_t DRAM_LAST_CYCLE;      // latest completion seen
+
+void dram_reset() {
+	memset(DRAM, 0, sizeof(DRAM));
+	DRAM_NEXT_ID = 0;
+	DRAM_READS = DRAM_WRITES = 0;
+	DRAM_ROW_HITS = DRAM_ROW_EMPTY = DRAM_ROW_CONFLICTS = 0;
+	DRAM_READ_LATENCY = DRAM_QUEUE_FULL = 0;
+	DRAM_LAST_CYCLE = 0;
+}
+
+/* Open page: line -> column | channel | bank | rank | row, so a row holds 2 KB of consecutive lines.
+   Closed page: line -> channel | bank | rank | column | row, spreading consecutive lines over the banks. */
+void dram_map(uint32_t addr, uint32_t *channel, uint32_t *bank, uint32_t *row) {
+	uint32_t rest = DRAM_POLICY == DRAM_OPEN_PAGE ? (addr >> 4) / DRAM_ROW_LINES : addr >> 4;
+
+	*channel = rest % DRAM_CHANNELS;
+	rest /= DRAM_CHANNELS;
+	*bank = rest % DRAM_BANKS;
+	rest /= DRAM_BANKS;
+	*bank += (rest % DRAM_RANKS) * DRAM_BANKS;
+	*row = rest / DRAM_RANKS;
+	if (DRAM_POLICY == DRAM_CLOSED_PAGE) {
+		*row /= DRAM_ROW_LINES;
+	}
+}
+
+/***************************************************************/
+/* Issue one request FR-FCFS: among the requests that have     */
+/* arrived, a row hit on a ready bank goes first, then the     */
+/* oldest request on a ready bank. Returns its completion.     */
+/***************************************************************/
+uint32_t dram_schedule(DRAM_Channel *ch, uint32_t *id) {
+	DRAM_Request *r, *pick;
+	DRAM_Bank *bank;
+	uint32_t i, next, start, cmd, col, data;
+	int hit, pick_hit = FALSE;
+
+	for (;;) {
+		pick = NULL;
+		next = 0xFFFFFFFF;
+		for (i = 0; i < ch->count; i++) {
+			r = &ch->queue[i];
+			bank = &ch->banks[r->bank];
+			if (r->arrival > ch->clock) {
+				next = r->arrival < next ? r->arrival : next;
+				continue;
+			}
+			if (bank->ready > ch->clock) {
+				next = bank->ready < next ? bank->ready : next;
+				continue;
+			}
+			hit = bank->open && bank->open_row == r->row;
+			if (pick == NULL || (hit && !pick_hit) || (hit == pick_hit && r->arrival < pick->arrival)) {
+				pick = r;
+				pick_hit = hit;
+			}
+		}
+		if (pick) {
+			break;
+		}
+		ch->clock = next; // nothing can issue yet: skip to the next arrival or bank becoming ready
+	}
+
+	bank = &ch->banks[pick->bank];
+	start = ch->clock;
+	if (pick_hit) {
+		cmd = DRAM_TCAS;
+		SHARED_INC(DRAM_ROW_HITS, 1);
+	}
+	else if (!bank->open) {
+		cmd = DRAM_TRCD + DRAM_TCAS;
+		SHARED_INC(DRAM_ROW_EMPTY, 1);
+	}
+	else {
+		cmd = DRAM_TRP + DRAM_TRCD + DRAM_TCAS;
+		SHARED_INC(DRAM_ROW_CONFLICTS, 1);
+	}
+	col = start + cmd - DRAM_TCAS; // column command issues once the row is open
+	data = col + DRAM_TCAS > ch->bus_free ? col + DRAM_TCAS : ch->bus_free;
+	ch->bus_free = data + DRAM_TBURST;
+	ch->bus_busy += DRAM_TBURST;
+	if (DRAM_POLICY == DRAM_OPEN_PAGE) {
+		bank->open = TRUE;
+		bank->open_row = pick->row;
+		bank->ready = col + DRAM_TBURST; // back-to-back column commands to the open row
+	}
+	else {
+		bank->open = FALSE;
+		bank->ready = ch->bus_free + DRAM_TRP;
+	}
+	ch->clock = start + 1; // one command per cycle on the command bus
+	if (ch->bus_free > DRAM_LAST_CYCLE) {
+		DRAM_LAST_CYCLE = ch->bus_free;
+	}
+
+	*id = pick->id;
+	*pick = ch->queue[--ch->count];
+	return data + DRAM_TBURST;
+}
+
+/* Queue a request; a full queue first issues whatever the scheduler picks */
+uint32_t dram_enqueue(DRAM_Channel *ch, uint32_t bank, uint32_t row, int write, uint32_t now) {
+	DRAM_Request *r;
+	uint32_t id;
+
+	if (ch->count == DRAM_QUEUE_SIZE) {
+		dram_schedule(ch, &id);
+		SHARED_INC(DRAM_QUEUE_FULL, 1);
+	}
+	if (ch->clock < now && ch->count == 0) {
+		ch->clock = now; // idle channel: nothing to catch up on
+	}
+	r = &ch->queue[ch->count++];
+	r->arrival = now;
+	r->bank = bank;
+	r->row = row;
+	r->write = write;
+	r->id = DRAM_NEXT_ID++;
+	return r->id;
+}
+
+/***************************************************************/
+/* Line fill of addr requested at cycle now: returns the       */
+/* latency until the whole line has arrived                    */
+/***************************************************************/
+uint32_t dram_read(uint32_t addr, uint32_t now) {
+	DRAM_Channel *ch;
+	uint32_t channel, bank, row, id, served, done;
+
+	if (PARALLEL_ACTIVE) {
+		pthread_mutex_lock(&DRAM_LOCK);
+	}
+	dram_map(addr, &channel, &bank, &row);
+	ch = &DRAM[channel];
+	id = dram_enqueue(ch, bank, row, FALSE, now);
+	do { // older and row-hit requests ahead of this one issue first
+		done = dram_schedule(ch, &served);
+	} while (served != id);
+	SHARED_INC(DRAM_READS, 1);
+	SHARED_INC(DRAM_READ_LATENCY, done - now);
+	if (PARALLEL_ACTIVE) {
+		pthread_mutex_unlock(&DRAM_LOCK);
+	}
+	return done - now;
+}
+
+/* Posted write-through of the line holding addr; it issues whenever the scheduler gets to it */
+void dram_write(uint32_t addr, uint32_t now) {
+	uint32_t channel, bank, row;
+
+	if (PARALLEL_ACTIVE) {
+		pthread_mutex_lock(&DRAM_LOCK);
+	}
+	dram_map(addr, &channel, &bank, &row);
+	dram_enqueue(&DRAM[channel], bank, row, TRUE, now);
+	SHARED_INC(DRAM_WRITES, 1);
+	if (PARALLEL_ACTIVE) {
+		pthread_mutex_unlock(&DRAM_LOCK);
+	}
+}
+
+/* Latency of a line fill issued at cycle now: the DRAM model, or the flat miss penalty */
+uint32_t mem_fill_latency(uint32_t addr, uint32_t now) {
+	return DRAM_ENABLED ? dram_read(addr, now) : CACHE_MISS_PENALTY;
+}
+
+/***************************************************************/
+/* Called from MEM(): stores write through to DRAM             */
+/***************************************************************/
+void dram_access(uint32_t opcode, uint32_t addr) {
+	switch (opcode) {
+		case 0x28: case 0x29: case 0x2B: // SB, SH, SW
+			dram_write(addr, CYCLE_COUNT);
+			break;
+	}
+}
+
+/* set dram* parameters; any change starts from an idle, precharged DRAM */
+void dram_set(const char *name, int value) {
+	uint32_t *param = NULL, min = 0, max = 0xFFFF;
+
+	if (strcmp(name, "dram") == 0) {
+		DRAM_ENABLED = value != 0;
+	}
+	else if (strcmp(name, "dram_policy") == 0) {
+		DRAM_POLICY = value ? DRAM_CLOSED_PAGE : DRAM_OPEN_PAGE;
+	}
+	else if (strcmp(name, "dram_channels") == 0) { param = &DRAM_CHANNELS; min = 1; max = DRAM_MAX_CHANNELS; }
+	else if (strcmp(name, "dram_ranks") == 0) { param = &DRAM_RANKS; min = 1; max = DRAM_MAX_RANKS; }
+	else if (strcmp(name, "dram_banks") == 0) { param = &DRAM_BANKS; min = 1; max = DRAM_MAX_BANKS; }
+	else if (strcmp(name, "dram_trcd") == 0) { param = &DRAM_TRCD; }
+	else if (strcmp(name, "dram_tcas") == 0) { param = &DRAM_TCAS; }
+	else if (strcmp(name, "dram_trp") == 0) { param = &DRAM_TRP; }
+	else {
+		printf("Unknown DRAM parameter %s\n", name);
+		return;
+	}
+	if (param) {
+		if (value < (int)min || value > (int)max) {
+			printf("%s must be between %u and %u\n", name, min, max);
+			return;
+		}
+		*param = value;
+	}
+	dram_reset();
+	printf("DRAM %s: %u channel(s) x %u rank(s) x %u banks, %s page, tRCD %u tCAS %u tRP %u\n", DRAM_ENABLED ? "ON" : "OFF",
+		DRAM_CHANNELS, DRAM_RANKS, DRAM_BANKS, DRAM_POLICY == DRAM_OPEN_PAGE ? "open" : "closed", DRAM_TRCD, DRAM_TCAS, DRAM_TRP);
+}
+
+/* Cycles the DRAM has been running, for bandwidth; fills may complete after CYCLE_COUNT */
+uint32_t dram_elapsed() {
+	return DRAM_LAST_CYCLE > CYCLE_COUNT ? DRAM_LAST_CYCLE : CYCLE_COUNT;
+}
+
+/* Fraction of the channels' peak data-bus bandwidth used */
+double dram_utilization() {
+	uint64_t busy = 0;
+	uint32_t c;
+
+	for (c = 0; c < DRAM_CHANNELS; c++) {
+		busy += DRAM[c].bus_busy;
+	}
+	return dram_elapsed() ? (double)busy / ((double)dram_elapsed() * DRAM_CHANNELS) : 0.0;
+}
+
+/************************************************************/
+/* Print row-buffer locality, latency and bandwidth         */
+/************************************************************/
+void dram_dump() {
+	uint64_t accesses = DRAM_ROW_HITS + DRAM_ROW_EMPTY + DRAM_ROW_CONFLICTS;
+
+	printf("-------------------------------------------------------------\n");
+	printf("DRAM %s: %u channel(s) x %u rank(s) x %u banks, %s page\n", DRAM_ENABLED ? "ON" : "OFF",
+		DRAM_CHANNELS, DRAM_RANKS, DRAM_BANKS, DRAM_POLICY == DRAM_OPEN_PAGE ? "open" : "closed");
+	printf("tRCD %u  tCAS %u  tRP %u  tBURST %u cycles\n", DRAM_TRCD, DRAM_TCAS, DRAM_TRP, DRAM_TBURST);
+	printf("-------------------------------------------------------------\n");
+	printf("reads\t\t%llu\n", (unsigned long long)DRAM_READS);
+	printf("writes\t\t%llu\tposted write-through\n", (unsigned long long)DRAM_WRITES);
+	printf("row hits\t%llu\n", (unsigned long long)DRAM_ROW_HITS);
+	printf("row empty\t%llu\n", (unsigned long long)DRAM_ROW_EMPTY);
+	printf("row conflicts\t%llu\n", (unsigned long long)DRAM_ROW_CONFLICTS);
+	printf("row hit rate\t%.2f%%\n", accesses ? 100.0 * DRAM_ROW_HITS / accesses : 0.0);
+	printf("avg read lat\t%.2f\tcycles\n", DRAM_READS ? (double)DRAM_READ_LATENCY / DRAM_READS : 0.0);
+	printf("queue full\t%llu\n", (unsigned long long)DRAM_QUEUE_FULL);
+	printf("bandwidth\t%.3f\tbytes/cycle (%.2f%% of peak)\n",
+		dram_elapsed() ? (double)accesses * WORD_PER_BLOCK * 4 / dram_elapsed() : 0.0, 100.0 * dram_utilization());
+	printf("-------------------------------------------------------------\n");
+}
@@ -0,0 +1,143 @@
+/******************************************************************************/
+/* EVENT-DRIVEN KERNEL: SKIP CYCLES IN WHICH NO CORE CAN ADVANCE              */
+/******************************************************************************/
+#define EVENT_WHEEL_SLOTS 1024      // power of two; wakes further out wait in EVENT_FAR
+#define EVENT_NONE        0xFFFFFFFF
+
+/* Wake-ups due in one wheel slot; cycle tells laps of the wheel apart */
+typedef struct Event_Slot_Struct {
+	uint32_t cycle;
+	uint32_t pending;
+} Event_Slot;
+
+/* Why one core is frozen, so the skipped cycles are charged exactly as stepping them would */
+typedef struct Event_Core_Struct {
+	int idle;                       // the last core_cycle() advanced nothing
+	perf_counter_t cause;
+	int unit;                       // FU_* for PERF_FU_STALL
+} Event_Core;
+
+int EVENT_DRIVEN = TRUE;            // FALSE = step every cycle
+Event_Slot EVENT_WHEEL[EVENT_WHEEL_SLOTS];
+uint32_t EVENT_FAR = EVENT_NONE;    // earliest wake-up beyond the wheel
+Event_Core EVENT_CORE[MAX_CORES];   // indexed by CURRENT_CORE
+
+void event_reset() {
+	memset(EVENT_WHEEL, 0, sizeof(EVENT_WHEEL));
+	memset(EVENT_CORE, 0, sizeof(EVENT_CORE));
+	EVENT_FAR = EVENT_NONE;
+}
+
+/* Schedule a wake-up at cycle */
+void event_post(uint32_t cycle) {
+	Event_Slot *s = &EVENT_WHEEL[cycle & (EVENT_WHEEL_SLOTS - 1)];
+
+	if (cycle - CYCLE_COUNT >= EVENT_WHEEL_SLOTS) {
+		EVENT_FAR = cycle < EVENT_FAR ? cycle : EVENT_FAR;
+		return;
+	}
+	if (s->cycle != cycle) { // left over from an earlier lap
+		s->cycle = cycle;
+		s->pending = 0;
+	}
+	s->pending++;
+}
+
+/* Earliest wake-up at or after now, removing it from the wheel; EVENT_NONE when there is none */
+uint32_t event_next(uint32_t now) {
+	Event_Slot *s;
+	uint32_t i, cycle;
+
+	for (i = 0; i < EVENT_WHEEL_SLOTS; i++) {
+		s = &EVENT_WHEEL[(now + i) & (EVENT_WHEEL_SLOTS - 1)];
+		if (s->pending && s->cycle == now + i) {
+			s->pending = 0;
+			return now + i;
+		}
+	}
+	cycle = EVENT_FAR;
+	EVENT_FAR = EVENT_NONE;
+	return cycle != EVENT_NONE && cycle >= now ? cycle : EVENT_NONE;
+}
+
+/***************************************************************/
+/* Called from core_cycle() when the running core stays frozen */
+/* for the next n cycles because of cause                       */
+/***************************************************************/
+void event_idle(perf_counter_t cause, int unit, uint32_t n) {
+	Event_Core *e = &EVENT_CORE[CURRENT_CORE];
+
+	if (!EVENT_DRIVEN || n == 0) {
+		return;
+	}
+	e->idle = TRUE;
+	e->cause = cause;
+	e->unit = unit;
+	event_post(CYCLE_COUNT + 1 + n);
+}
+
+/* Account n frozen cycles of the running core in one step */
+void event_skip_core(uint32_t n) {
+	Event_Core *e = &EVENT_CORE[CURRENT_CORE];
+
+	if (MSHR_COUNT) {
+		MSHR_STATE[CURRENT_CORE].now += n;
+	}
+	FU_STATE[CURRENT_CORE].now += n;
+	PERF_COUNTERS[e->cause] += n;
+	PROFILE_PENDING_STALL += n;
+	switch (e->cause) {
+		case PERF_CACHE_MISS_STALL: MEM_STALL_CYCLES -= n; break;
+		case PERF_MSHR_STALL: SHARED_INC(MSHR_DEP_CYCLES, n); break;
+		case PERF_FU_STALL: SHARED_INC(FU_BUSY_CYCLES[e->unit], n); break;
+		case PERF_HILO_STALL: SHARED_INC(FU_HILO_CYCLES, n); break;
+		default: break;
+	}
+	e->idle = FALSE;
+}
+
+/***************************************************************/
+/* Called from run()/runAll() after each cycle: when every     */
+/* running core is frozen, jump CYCLE_COUNT to the next wake-up */
+/* (at most limit cycles, never past a telemetry sample).       */
+/* Returns the cycles skipped                                   */
+/***************************************************************/
+uint32_t event_skip(uint32_t limit) {
+	uint32_t wake, n;
+	int i, core = CURRENT_CORE;
+
+	if (!EVENT_DRIVEN || limit == 0) {
+		return 0;
+	}
+	for (i = 0; i < NUM_CORES; i++) {
+		if (!EVENT_CORE[i].idle && !(NUM_CORES > 1 && CORES[i].halted)) {
+			return 0;
+		}
+	}
+	wake = event_next(CYCLE_COUNT);
+	if (wake == EVENT_NONE || wake <= CYCLE_COUNT) {
+		return 0;
+	}
+	n = wake - CYCLE_COUNT;
+	n = n < limit ? n : limit;
+	if (TELEMETRY_NEXT > CYCLE_COUNT && TELEMETRY_NEXT - CYCLE_COUNT < n) {
+		n = TELEMETRY_NEXT - CYCLE_COUNT;
+	}
+	if (NUM_CORES > 1) {
+		for (i = 0; i < NUM_CORES; i++) {
+			if (!CORES[i].halted) {
+				core_switch(i);
+				event_skip_core(n);
+				CORE_STATS[i].cycles += n;
+			}
+		}
+		core_switch(core);
+	}
+	else {
+		event_skip_core(n);
+	}
+	CYCLE_COUNT += n;
+	HOST_SKIPPED_CYCLES += n;
+	TELEMETRY_TICK();
+	return n;
+}
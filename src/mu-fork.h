@@ -0,0 +1,165 @@
+/******************************************************************************/
+/* COPY-ON-WRITE FAN-OUT: FORK A WARMED SIMULATION, ONE CHILD PER CONFIG      */
+/******************************************************************************/
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define FORK_MAX_CHILDREN 64
+
+/* What a child writes back to the parent; counts start at the fork point */
+typedef struct Fork_Result_Struct {
+	uint32_t cycles;
+	uint32_t instructions;
+	uint32_t cache_hits, cache_misses;
+	int halted;
+	int exit_code;
+} Fork_Result;
+
+char FORK_SPECS[FORK_MAX_CHILDREN][108]; // filled by the fork command
+uint32_t FORK_MAX_CYCLES = 10000000;     // a child that has not halted by then reports "-"
+
+/***************************************************************/
+/* Apply "name=value,name=value"; "-" keeps the parent's       */
+/* configuration. FALSE on a malformed item                     */
+/***************************************************************/
+int fork_configure(const char *spec, int apply) {
+	char buf[108], *item, *save, *eq;
+	long value;
+
+	if (strcmp(spec, "-") == 0) {
+		return TRUE;
+	}
+	snprintf(buf, sizeof(buf), "%s", spec);
+	for (item = strtok_r(buf, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+		if ((eq = strchr(item, '=')) == NULL || eq == item || eq[1] == '\0') {
+			printf("Error: expected <param>=<value> in %s\n", spec);
+			return FALSE;
+		}
+		*eq = '\0';
+		value = strtol(eq + 1, NULL, 0);
+		if (apply) {
+			set_param(item, value);
+		}
+	}
+	return TRUE;
+}
+
+/***************************************************************/
+/* Called first in a child: the parent keeps the terminal, the */
+/* telemetry writer and any -o/-i file. Guest output is dropped */
+/* and read_int sees end of input                               */
+/***************************************************************/
+void fork_detach() {
+	if (freopen("/dev/null", "w", stdout) == NULL) {
+		_exit(EXIT_USAGE);
+	}
+	SYSCALL_OUT_FILE = NULL;
+	SYSCALL_IN_FILE = fopen("/dev/null", "r"); // reading stdin would move the parent's offset
+	TELEMETRY_RUNNING = FALSE;
+	TELEMETRY_NEXT = TELEMETRY_OFF;
+	BATCH_MODE = TRUE;
+}
+
+/***************************************************************/
+/* Runs in the child: reconfigure, simulate until the program  */
+/* halts or FORK_MAX_CYCLES pass, report over fd. Never returns */
+/***************************************************************/
+void fork_child(const char *spec, int fd) {
+	Fork_Result r;
+	uint32_t cycles = CYCLE_COUNT, insts = INSTRUCTION_COUNT, hits = cache_hits, misses = cache_misses;
+
+	fork_detach();
+	fork_configure(spec, TRUE);
+	run(FORK_MAX_CYCLES);
+	syscall_flush();
+
+	r.cycles = CYCLE_COUNT - cycles;
+	r.instructions = INSTRUCTION_COUNT - insts;
+	r.cache_hits = cache_hits - hits;
+	r.cache_misses = cache_misses - misses;
+	r.halted = !RUN_FLAG;
+	r.exit_code = SYSCALL_EXIT_CODE;
+	_exit(write(fd, &r, sizeof(r)) == sizeof(r) ? EXIT_HALTED : EXIT_USAGE);
+}
+
+/* Read exactly one size-byte result; FALSE if the child died before sending it */
+int fork_collect(int fd, void *r, size_t size) {
+	size_t got = 0;
+	ssize_t n;
+
+	while (got < size) {
+		n = read(fd, (char *)r + got, size - got);
+		if (n <= 0) {
+			return FALSE;
+		}
+		got += n;
+	}
+	return TRUE;
+}
+
+/***************************************************************/
+/* Clone the simulator once per spec; each child shares guest  */
+/* memory with the parent until it writes a page, so the warm  */
+/* prefix is simulated only once. Waits for every child and     */
+/* prints their statistics; the parent's state is untouched     */
+/***************************************************************/
+void fork_run(char specs[][108], int n) {
+	pid_t pids[FORK_MAX_CHILDREN];
+	int fds[FORK_MAX_CHILDREN], p[2], i, status, launched = 0;
+	Fork_Result r;
+	struct timespec start, end;
+
+	for (i = 0; i < n; i++) {
+		if (!fork_configure(specs[i], FALSE)) {
+			return;
+		}
+	}
+	if (RUN_FLAG == FALSE) {
+		printf("Simulation Stopped\n\n");
+		return;
+	}
+	syscall_flush(); // or every child would print the parent's pending output again
+	fflush(NULL);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < n; i++) {
+		if (pipe(p) != 0) {
+			printf("Error: Can't create a pipe for child %d\n", i);
+			break;
+		}
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			printf("Error: Can't fork child %d\n", i);
+			close(p[0]);
+			close(p[1]);
+			break;
+		}
+		if (pids[i] == 0) {
+			close(p[0]);
+			fork_child(specs[i], p[1]);
+		}
+		close(p[1]);
+		fds[i] = p[0];
+		launched++;
+	}
+
+	printf("-------------------------------------------------------------\n");
+	printf("[Child]\t[Cycles]\t[Insns]\t\t[CPI]\t[Hits]\t[Misses]\t[Exit]\t[Config]\n");
+	printf("-------------------------------------------------------------\n");
+	for (i = 0; i < launched; i++) {
+		if (fork_collect(fds[i], &r, sizeof(r))) {
+			printf("%d\t%u\t\t%u\t\t%.3f\t%u\t%u\t\t", i, r.cycles, r.instructions,
+				r.instructions ? (double)r.cycles / r.instructions : 0.0, r.cache_hits, r.cache_misses);
+			r.halted ? printf("%d", r.exit_code) : printf("-");
+			printf("\t%s\n", specs[i]);
+		}
+		else {
+			printf("%d\tfailed\t\t\t\t\t\t\t\t%s\n", i, specs[i]);
+		}
+		close(fds[i]);
+		waitpid(pids[i], &status, 0);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("-------------------------------------------------------------\n");
+	printf("Forked %d of %d at cycle %u, up to %u cycles each; children finished in %.3f ms\n", launched, n, CYCLE_COUNT, FORK_MAX_CYCLES,
+		(end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+}
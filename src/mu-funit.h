@@ -0,0 +1,180 @@
+/******************************************************************************/
+/* MULTI-CYCLE FUNCTIONAL UNITS: MULTIPLIER AND DIVIDER                       */
+/******************************************************************************/
+typedef enum {
+	FU_MUL,         // MULT, MULTU
+	FU_DIV,         // DIV, DIVU
+	NUM_FUNITS
+} funit_t;
+
+const char *FUNIT_NAMES[NUM_FUNITS] = { "mul", "div" };
+
+typedef struct FUnit_Config_Struct {
+	uint32_t latency;   // cycles from entering EX until HI/LO can be read
+	int pipelined;      // FALSE = busy for the whole latency
+} FUnit_Config;
+
+/* One core's units; now counts every core cycle, frozen or not */
+typedef struct FUnit_State_Struct {
+	uint32_t now;
+	uint32_t busy_until[NUM_FUNITS];    // first cycle the unit accepts a new operation
+	uint32_t hilo_ready;                // cycle the last MULT/DIV writes HI/LO
+} FUnit_State;
+
+FUnit_Config FUNITS[NUM_FUNITS] = { { 1, TRUE }, { 1, TRUE } }; // single-cycle, as EX() computes them
+FUnit_State FU_STATE[MAX_CORES];    // indexed by CURRENT_CORE
+
+/* Statistics, shared by all cores */
+uint64_t FU_OPS[NUM_FUNITS];
+uint64_t FU_BUSY_CYCLES[NUM_FUNITS];  // cycles frozen on a busy unpipelined unit
+uint64_t FU_HILO_CYCLES;              // cycles an HI/LO access waited on a result in flight
+
+void fu_reset() {
+	memset(FU_STATE, 0, sizeof(FU_STATE));
+	memset(FU_OPS, 0, sizeof(FU_OPS));
+	memset(FU_BUSY_CYCLES, 0, sizeof(FU_BUSY_CYCLES));
+	FU_HILO_CYCLES = 0;
+}
+
+/* set mul_* / div_* parameters */
+void fu_set(const char *name, int value) {
+	FUnit_Config *u = &FUNITS[name[0] == 'm' ? FU_MUL : FU_DIV];
+
+	if (strcmp(name + 4, "latency") == 0) {
+		if (value < 1 || value > 256) {
+			printf("%s must be between 1 and 256\n", name);
+			return;
+		}
+		u->latency = value;
+	}
+	else if (strcmp(name + 4, "pipelined") == 0) {
+		u->pipelined = value != 0;
+	}
+	else {
+		printf("Unknown functional unit parameter %s\n", name);
+		return;
+	}
+	fu_reset();
+	printf("Multiplier: %u cycles, %s; divider: %u cycles, %s\n",
+		FUNITS[FU_MUL].latency, FUNITS[FU_MUL].pipelined ? "pipelined" : "unpipelined",
+		FUNITS[FU_DIV].latency, FUNITS[FU_DIV].pipelined ? "pipelined" : "unpipelined");
+}
+
+/* Unit that executes ir, or -1 for the single-cycle ALU */
+int fu_unit(uint32_t ir) {
+	if ((ir & 0xFC000000) != 0 || ir == 0x00000001) {
+		return -1;
+	}
+	switch (ir & 0x0000003F) {
+		case 0x18: case 0x19: return FU_MUL;
+		case 0x1A: case 0x1B: return FU_DIV;
+		default: return -1;
+	}
+}
+
+/* TRUE for MFHI, MTHI, MFLO, MTLO */
+int fu_hilo(uint32_t ir) {
+	return (ir & 0xFC000000) == 0 && ir != 0x00000001 && (ir & 0x0000003C) == 0x10;
+}
+
+/* Claim unit u at cycle now; returns the cycle its result is ready */
+uint32_t fu_reserve(uint32_t *busy_until, int u, uint32_t now) {
+	*busy_until = now + (FUNITS[u].pipelined ? 1 : FUNITS[u].latency);
+	SHARED_INC(FU_OPS[u], 1);
+	return now + FUNITS[u].latency;
+}
+
+/***************************************************************/
+/* TRUE while ir cannot enter EX at this core's current cycle: */
+/* its unit is busy, or it touches HI/LO before a MULT/DIV in   */
+/* flight has written them. *cause gets the stall counter       */
+/***************************************************************/
+int fu_waits(uint32_t ir, perf_counter_t *cause) {
+	FUnit_State *f = &FU_STATE[CURRENT_CORE];
+	int u = fu_unit(ir);
+
+	if (u >= 0 && f->busy_until[u] > f->now) {
+		*cause = PERF_FU_STALL;
+		return TRUE;
+	}
+	if (fu_hilo(ir) && f->hilo_ready > f->now) {
+		*cause = PERF_HILO_STALL;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/* Unit cycle at which ir stops waiting in fu_waits() */
+uint32_t fu_ready(uint32_t ir) {
+	FUnit_State *f = &FU_STATE[CURRENT_CORE];
+	uint32_t ready = 0;
+	int u = fu_unit(ir);
+
+	if (u >= 0 && f->busy_until[u] > ready) {
+		ready = f->busy_until[u];
+	}
+	if (fu_hilo(ir) && f->hilo_ready > ready) {
+		ready = f->hilo_ready;
+	}
+	return ready;
+}
+
+/* Called from EX, once per instruction it executes: a MULT/DIV claims its unit and posts its HI/LO result time */
+void fu_issue(uint32_t ir) {
+	FUnit_State *f = &FU_STATE[CURRENT_CORE];
+	uint32_t ready;
+	int u = fu_unit(ir);
+
+	if (u < 0) {
+		return;
+	}
+	ready = fu_reserve(&f->busy_until[u], u, f->now);
+	if (ready > f->hilo_ready) { // a short MULT behind a long DIV still writes HI/LO after it
+		f->hilo_ready = ready;
+	}
+}
+
+/* Count a frozen cycle against its cause */
+void fu_stalled(uint32_t ir, perf_counter_t cause) {
+	if (cause == PERF_FU_STALL) {
+		SHARED_INC(FU_BUSY_CYCLES[fu_unit(ir)], 1);
+	}
+	else {
+		SHARED_INC(FU_HILO_CYCLES, 1);
+	}
+	PERF_INC(cause);
+}
+
+/***************************************************************/
+/* Called from core_cycle() for the scalar pipeline: TRUE      */
+/* while the instruction about to execute waits on a unit,      */
+/* with *waiting set to it                                      */
+/***************************************************************/
+int fu_stall(uint32_t *waiting) {
+	perf_counter_t cause;
+
+	*waiting = pipeline_ex_ir();
+	if (fu_waits(*waiting, &cause)) {
+		fu_stalled(*waiting, cause);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/************************************************************/
+/* Print functional unit configuration and stalls           */
+/************************************************************/
+void fu_dump() {
+	int u;
+
+	printf("-------------------------------------------------------------\n");
+	printf("[Unit]\t[Latency]\t[Pipelined]\t[Ops]\t[Busy stalls]\n");
+	printf("-------------------------------------------------------------\n");
+	for (u = 0; u < NUM_FUNITS; u++) {
+		printf("%s\t%u\t\t%s\t\t%llu\t%llu\n", FUNIT_NAMES[u], FUNITS[u].latency, FUNITS[u].pipelined ? "yes" : "no",
+			(unsigned long long)FU_OPS[u], (unsigned long long)FU_BUSY_CYCLES[u]);
+	}
+	printf("-------------------------------------------------------------\n");
+	printf("HI/LO interlock\t%llu\tcycles\n", (unsigned long long)FU_HILO_CYCLES);
+	printf("-------------------------------------------------------------\n");
+}
@@ -0,0 +1,203 @@
+/******************************************************************************/
+/* HOST-SIDE SIMULATOR INSTRUMENTATION                                        */
+/******************************************************************************/
+#include <time.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+typedef enum {
+	HOST_WB,
+	HOST_MEM,
+	HOST_EX,
+	HOST_ID,
+	HOST_IF,
+	NUM_HOST_STAGES
+} host_stage_t;
+
+const char *HOST_STAGE_NAMES[NUM_HOST_STAGES] = { "WB", "MEM", "EX", "ID", "IF" };
+
+typedef enum {
+	HOST_PMU_INSTRUCTIONS,
+	HOST_PMU_CYCLES,
+	HOST_PMU_CACHE_MISSES,
+	HOST_PMU_BRANCH_MISSES,
+	NUM_HOST_PMU_EVENTS
+} host_pmu_event_t;
+
+uint32_t HOST_STAGE_SAMPLE;  // time the stages of one cycle in every N (0 = off)
+int HOST_PERF;               // read host PMU counters through perf_event_open
+
+/* Per-run state */
+struct timespec HOST_RUN_START;
+uint32_t HOST_RUN_CYCLES, HOST_RUN_INSTRUCTIONS;
+uint64_t HOST_SKIPPED_CYCLES;   // cycles the event-driven kernel jumped over instead of simulating
+uint64_t HOST_STAGE_NS[NUM_HOST_STAGES];
+uint64_t HOST_STAGE_SAMPLES;
+uint64_t HOST_STAGE_PMU[NUM_HOST_STAGES][NUM_HOST_PMU_EVENTS];
+uint64_t HOST_RUN_PMU[NUM_HOST_PMU_EVENTS];
+int HOST_PMU_FD = -1;
+
+uint64_t host_now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/***************************************************************/
+/* Host PMU counters (Linux only)                              */
+/***************************************************************/
+#ifdef __linux__
+/* Open all events as one group so they are scheduled and read together */
+int host_pmu_open() {
+	static const uint64_t configs[NUM_HOST_PMU_EVENTS] = {
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES
+	};
+	struct perf_event_attr attr;
+	int i, fd;
+
+	if (HOST_PMU_FD >= 0) {
+		return 1;
+	}
+	for (i = 0; i < NUM_HOST_PMU_EVENTS; i++) {
+		memset(&attr, 0, sizeof(attr));
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = configs[i];
+		attr.read_format = PERF_FORMAT_GROUP;
+		attr.disabled = (i == 0);
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : HOST_PMU_FD, 0);
+		if (fd < 0) {
+			printf("perf_event_open failed for host event %d; host PMU counters disabled.\n", i);
+			if (HOST_PMU_FD >= 0) {
+				close(HOST_PMU_FD); // closing the leader tears down the group
+				HOST_PMU_FD = -1;
+			}
+			return 0;
+		}
+		if (i == 0) {
+			HOST_PMU_FD = fd;
+		}
+	}
+	ioctl(HOST_PMU_FD, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(HOST_PMU_FD, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return 1;
+}
+
+void host_pmu_read(uint64_t *values) {
+	uint64_t buf[1 + NUM_HOST_PMU_EVENTS];
+	if (read(HOST_PMU_FD, buf, sizeof(buf)) == sizeof(buf)) {
+		memcpy(values, &buf[1], NUM_HOST_PMU_EVENTS * sizeof(uint64_t));
+	}
+}
+#else
+int host_pmu_open() {
+	printf("Host PMU counters need Linux perf_event_open.\n");
+	return 0;
+}
+
+void host_pmu_read(uint64_t *values) {
+	memset(values, 0, NUM_HOST_PMU_EVENTS * sizeof(uint64_t));
+}
+#endif
+
+/***************************************************************/
+/* Sampled pipeline: handle_pipeline() with each stage timed    */
+/***************************************************************/
+void host_sampled_pipeline() {
+	void (*stages[NUM_HOST_STAGES])() = { WB, MEM, EX, ID, IF };
+	uint64_t before[NUM_HOST_PMU_EVENTS], after[NUM_HOST_PMU_EVENTS];
+	uint64_t t0, t1;
+	int s, e;
+
+	for (s = 0; s < NUM_HOST_STAGES; s++) {
+		if (HOST_PERF) {
+			host_pmu_read(before);
+		}
+		t0 = host_now_ns();
+		stages[s]();
+		t1 = host_now_ns();
+		HOST_STAGE_NS[s] += t1 - t0;
+		if (HOST_PERF) {
+			host_pmu_read(after);
+			for (e = 0; e < NUM_HOST_PMU_EVENTS; e++) {
+				HOST_STAGE_PMU[s][e] += after[e] - before[e];
+			}
+		}
+	}
+	HOST_STAGE_SAMPLES++;
+}
+
+/***************************************************************/
+/* Bracket a run()/runAll() call                               */
+/***************************************************************/
+void host_run_begin() {
+	memset(HOST_STAGE_NS, 0, sizeof(HOST_STAGE_NS));
+	memset(HOST_STAGE_PMU, 0, sizeof(HOST_STAGE_PMU));
+	HOST_STAGE_SAMPLES = 0;
+	HOST_SKIPPED_CYCLES = 0;
+	if (HOST_PERF && !host_pmu_open()) {
+		HOST_PERF = 0;
+	}
+	if (HOST_PERF) {
+		host_pmu_read(HOST_RUN_PMU);
+	}
+	HOST_RUN_CYCLES = CYCLE_COUNT;
+	HOST_RUN_INSTRUCTIONS = INSTRUCTION_COUNT;
+	clock_gettime(CLOCK_MONOTONIC, &HOST_RUN_START);
+}
+
+/* Print the one-line throughput summary, plus stage and PMU detail when enabled */
+void host_run_end() {
+	struct timespec now;
+	uint64_t pmu[NUM_HOST_PMU_EVENTS];
+	double secs;
+	uint32_t cycles, insts;
+	int s;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	secs = (now.tv_sec - HOST_RUN_START.tv_sec) + (now.tv_nsec - HOST_RUN_START.tv_nsec) / 1e9;
+	if (secs <= 0) {
+		secs = 1e-9;
+	}
+	cycles = CYCLE_COUNT - HOST_RUN_CYCLES;
+	insts = INSTRUCTION_COUNT - HOST_RUN_INSTRUCTIONS;
+
+	printf("[host] %u cycles, %u instructions in %.3f ms: %.0f cycles/s, %.0f instructions/s\n",
+		cycles, insts, secs * 1e3, cycles / secs, insts / secs);
+	if (HOST_SKIPPED_CYCLES > 0) {
+		printf("[host] %llu idle cycles (%.1f%%) skipped to the next event\n",
+			(unsigned long long)HOST_SKIPPED_CYCLES, cycles ? 100.0 * HOST_SKIPPED_CYCLES / cycles : 0.0);
+	}
+
+	if (HOST_STAGE_SAMPLES > 0) {
+		printf("[host] stage ns/cycle (%llu samples):", (unsigned long long)HOST_STAGE_SAMPLES);
+		for (s = 0; s < NUM_HOST_STAGES; s++) {
+			printf(" %s %.0f", HOST_STAGE_NAMES[s], (double)HOST_STAGE_NS[s] / HOST_STAGE_SAMPLES);
+		}
+		printf("\n");
+	}
+	if (HOST_PERF) {
+		host_pmu_read(pmu);
+		for (s = 0; s < NUM_HOST_PMU_EVENTS; s++) {
+			pmu[s] -= HOST_RUN_PMU[s];
+		}
+		printf("[host] run: IPC %.2f, %llu cache misses, %llu branch misses\n",
+			pmu[HOST_PMU_CYCLES] ? (double)pmu[HOST_PMU_INSTRUCTIONS] / pmu[HOST_PMU_CYCLES] : 0.0,
+			(unsigned long long)pmu[HOST_PMU_CACHE_MISSES], (unsigned long long)pmu[HOST_PMU_BRANCH_MISSES]);
+		for (s = 0; s < NUM_HOST_STAGES && HOST_STAGE_SAMPLES > 0; s++) {
+			printf("[host] %-3s: IPC %.2f, %.2f cache misses/cycle, %.2f branch misses/cycle\n", HOST_STAGE_NAMES[s],
+				HOST_STAGE_PMU[s][HOST_PMU_CYCLES] ? (double)HOST_STAGE_PMU[s][HOST_PMU_INSTRUCTIONS] / HOST_STAGE_PMU[s][HOST_PMU_CYCLES] : 0.0,
+				(double)HOST_STAGE_PMU[s][HOST_PMU_CACHE_MISSES] / HOST_STAGE_SAMPLES,
+				(double)HOST_STAGE_PMU[s][HOST_PMU_BRANCH_MISSES] / HOST_STAGE_SAMPLES);
+		}
+	}
+}
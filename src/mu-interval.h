@@ -0,0 +1,198 @@
+/******************************************************************************/
+/* INTERVAL SIMULATION: FUNCTIONAL FAST-FORWARD, DETAILED INTERVALS IN PARALLEL */
+/******************************************************************************/
+#define INTERVAL_MAX_JOBS 256
+
+uint32_t INTERVAL_JOBS;             // intervals simulated at once (0 = one per host CPU)
+
+/* What the child simulating one interval writes back */
+typedef struct Interval_Result_Struct {
+	uint32_t begin;         // INSTRUCTION_COUNT when measurement started
+	uint32_t instructions;
+	uint32_t cycles;
+	uint32_t cache_hits, cache_misses;
+} Interval_Result;
+
+/***************************************************************/
+/* Execute one instruction architecturally: no pipeline, cache */
+/* or statistics; memory is read and written directly          */
+/***************************************************************/
+void functional_step() {
+	SS_Slot s;
+	uint32_t a, target, pc = CURRENT_STATE.PC;
+
+	ss_decode(&s, mem_read_32(pc), pc);
+	a = s.src[0] == REG_HI ? CURRENT_STATE.HI : s.src[0] == REG_LO ? CURRENT_STATE.LO : CURRENT_STATE.REGS[s.src[0]];
+	CURRENT_STATE.PC = ss_evaluate(&s, a, CURRENT_STATE.REGS[s.src[1]], &target) ? target : pc + 4;
+	if (s.cls == SS_LOAD) {
+		s.result[0] = ss_load_value(&s, mem_read_32(s.addr & ~3u));
+	}
+	else if (s.cls == SS_STORE) {
+		mem_write_32(s.addr & ~3u, s.ir >> 26 == 0x2B ? s.data : ss_store_merge(&s, mem_read_32(s.addr & ~3u)));
+	}
+	ss_write_regs(&s, &CURRENT_STATE);
+	INSTRUCTION_COUNT++;
+	if (s.cls == SS_SYSCALL) {
+		syscall_exec(s.result[0], CURRENT_STATE.REGS[4], &CURRENT_STATE.REGS[2]);
+	}
+}
+
+/* Fast-forward until INSTRUCTION_COUNT reaches count or the program exits */
+void functional_run(uint32_t count) {
+	while (RUN_FLAG && INSTRUCTION_COUNT < count) {
+		functional_step();
+	}
+	NEXT_STATE = CURRENT_STATE;
+}
+
+/* Cycle the detailed model until INSTRUCTION_COUNT reaches count or the program exits */
+void interval_detailed(uint32_t count) {
+	while (RUN_FLAG && INSTRUCTION_COUNT < count) {
+		cycle();
+		event_skip(EVENT_NONE);
+	}
+}
+
+/***************************************************************/
+/* Runs in a child forked at a checkpoint: start every model   */
+/* cold, simulate in detail up to begin to warm them, then      */
+/* measure the k instructions after it. Never returns           */
+/***************************************************************/
+void interval_child(uint32_t begin, uint32_t k, int fd) {
+	Interval_Result r;
+	uint32_t cycles, hits, misses;
+
+	fork_detach();
+	memio_invalidate(0, 0xFFFFFFFF);
+	pipeline_clear();
+	prefetch_reset();
+	victim_reset();
+	mshr_reset();
+	dram_reset();
+	fu_reset();
+	ss_reset();
+	ooo_reset();
+	event_reset();
+	pipeline_select();
+
+	interval_detailed(begin);
+	r.begin = INSTRUCTION_COUNT;
+	cycles = CYCLE_COUNT;
+	hits = cache_hits;
+	misses = cache_misses;
+	interval_detailed(begin + k);
+
+	r.instructions = INSTRUCTION_COUNT - r.begin;
+	r.cycles = CYCLE_COUNT - cycles;
+	r.cache_hits = cache_hits - hits;
+	r.cache_misses = cache_misses - misses;
+	_exit(write(fd, &r, sizeof(r)) == sizeof(r) ? EXIT_HALTED : EXIT_USAGE);
+}
+
+/***************************************************************/
+/* Run the program to completion functionally, forking a        */
+/* checkpoint every k instructions (warmup before each interval  */
+/* start). Up to INTERVAL_JOBS children simulate their interval  */
+/* in detail at once; their cycles and cache statistics are      */
+/* summed into the whole-program totals                          */
+/***************************************************************/
+void interval_run(uint32_t k, uint32_t warmup) {
+	pid_t pids[INTERVAL_MAX_JOBS];
+	int fds[INTERVAL_MAX_JOBS], p[2], status, *ok = NULL;
+	Interval_Result *results = NULL, total = { 0, 0, 0, 0, 0 };
+	uint32_t jobs, base = INSTRUCTION_COUNT, begin, n = 0, done = 0, i;
+	struct timespec start, end;
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (k == 0 || warmup > k) {
+		printf("Intervals must be at least one instruction and no shorter than the warm-up\n");
+		return;
+	}
+	if (NUM_CORES > 1) {
+		printf("Interval simulation models a single core\n");
+		return;
+	}
+	if (CYCLE_COUNT != 0) {
+		printf("Interval simulation starts from a machine that has not been cycled: reset first\n");
+		return;
+	}
+	if (RUN_FLAG == FALSE) {
+		printf("Simulation Stopped\n\n");
+		return;
+	}
+	jobs = INTERVAL_JOBS ? INTERVAL_JOBS : cpus > 0 ? (uint32_t)cpus : 1;
+	jobs = jobs < INTERVAL_MAX_JOBS ? jobs : INTERVAL_MAX_JOBS;
+
+	syscall_flush(); // or every child would print the parent's pending output again
+	fflush(NULL);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (begin = base; RUN_FLAG; begin += k) {
+		functional_run(begin - base < warmup ? base : begin - warmup);
+		if (RUN_FLAG == FALSE) {
+			break;
+		}
+		if (n - done == jobs) { // pool full: wait for the oldest interval
+			ok[done] = fork_collect(fds[done % jobs], &results[done], sizeof(Interval_Result));
+			close(fds[done % jobs]);
+			waitpid(pids[done % jobs], &status, 0);
+			done++;
+		}
+		if (pipe(p) != 0) {
+			printf("Error: Can't create a pipe for interval %u\n", n);
+			break;
+		}
+		results = realloc(results, (n + 1) * sizeof(Interval_Result));
+		ok = realloc(ok, (n + 1) * sizeof(int));
+		pids[n % jobs] = fork();
+		if (pids[n % jobs] < 0) {
+			printf("Error: Can't fork interval %u\n", n);
+			close(p[0]);
+			close(p[1]);
+			break;
+		}
+		if (pids[n % jobs] == 0) {
+			close(p[0]);
+			interval_child(begin, k, p[1]);
+		}
+		close(p[1]);
+		fds[n % jobs] = p[0];
+		n++;
+	}
+	functional_run(0xFFFFFFFF); // the rest, if a fork failed
+	for (; done < n; done++) {
+		ok[done] = fork_collect(fds[done % jobs], &results[done], sizeof(Interval_Result));
+		close(fds[done % jobs]);
+		waitpid(pids[done % jobs], &status, 0);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("-------------------------------------------------------------\n");
+	printf("[Interval]\t[Start]\t\t[Insns]\t\t[Cycles]\t[CPI]\t[Hits]\t[Misses]\n");
+	printf("-------------------------------------------------------------\n");
+	for (i = 0; i < n; i++) {
+		if (!ok[i]) {
+			printf("%u\tfailed\n", i);
+			continue;
+		}
+		printf("%u\t\t%u\t\t%u\t\t%u\t\t%.3f\t%u\t%u\n", i, results[i].begin, results[i].instructions, results[i].cycles,
+			results[i].instructions ? (double)results[i].cycles / results[i].instructions : 0.0,
+			results[i].cache_hits, results[i].cache_misses);
+		total.instructions += results[i].instructions;
+		total.cycles += results[i].cycles;
+		total.cache_hits += results[i].cache_hits;
+		total.cache_misses += results[i].cache_misses;
+	}
+	printf("-------------------------------------------------------------\n");
+	printf("Total\t\t%u\t\t%u\t\t%u\t\t%.3f\t%u\t%u\n", base, total.instructions, total.cycles,
+		total.instructions ? (double)total.cycles / total.instructions : 0.0, total.cache_hits, total.cache_misses);
+	printf("-------------------------------------------------------------\n");
+	printf("%u interval%s of %u instructions, %u warm-up, %u job%s: %u instructions in %.3f ms\n",
+		n, n == 1 ? "" : "s", k, warmup, jobs, jobs == 1 ? "" : "s", INSTRUCTION_COUNT - base, (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+
+	// the machine ends halted, carrying the stitched estimate for rdump and the final stats
+	CYCLE_COUNT = total.cycles;
+	cache_hits += total.cache_hits;
+	cache_misses += total.cache_misses;
+	free(results);
+	free(ok);
+}
@@ -0,0 +1,259 @@
+/******************************************************************************/
+/* BULK MEMORY: DUMP TO FILE, DIFF DUMPS, IMPORT BLOBS                        */
+/******************************************************************************/
+#define MEMIO_PAGE        4096
+#define MEMIO_MAX_IMPORTS 16
+
+/* -L <addr>=<file> blobs, loaded again by every reset */
+typedef struct Memio_Import_Struct {
+	uint32_t addr;
+	const char *path;
+} Memio_Import;
+
+Memio_Import MEMIO_IMPORTS[MEMIO_MAX_IMPORTS];
+int MEMIO_NUM_IMPORTS;
+
+/* Host pointer to guest byte addr with *avail bytes left in its region; NULL when unmapped */
+uint8_t *mem_span(uint32_t addr, uint32_t *avail) {
+	int i;
+
+	for (i = 0; i < NUM_MEM_REGION; i++) {
+		if (addr >= MEM_REGIONS[i].begin && addr <= MEM_REGIONS[i].end) {
+			*avail = MEM_REGIONS[i].end - addr + 1;
+			return MEM_REGIONS[i].mem + (addr - MEM_REGIONS[i].begin);
+		}
+	}
+	*avail = 0xFFFFFFFF - addr + 1; // unmapped up to the next region, reads as zero
+	for (i = 0; i < NUM_MEM_REGION; i++) {
+		if (MEM_REGIONS[i].begin > addr && MEM_REGIONS[i].begin - addr < *avail) {
+			*avail = MEM_REGIONS[i].begin - addr;
+		}
+	}
+	return NULL;
+}
+
+/* Copy len bytes of guest memory from addr into buf */
+void memio_read(uint32_t addr, uint8_t *buf, uint32_t len) {
+	uint32_t avail, n;
+	uint8_t *p;
+
+	while (len > 0) {
+		p = mem_span(addr, &avail);
+		n = len < avail ? len : avail;
+		if (p) {
+			memcpy(buf, p, n);
+		}
+		else {
+			memset(buf, 0, n);
+		}
+		buf += n;
+		addr += n;
+		len -= n;
+	}
+}
+
+/* Drop cached copies of [start, stop] from every core's L1 and victim cache */
+void memio_invalidate(uint32_t start, uint32_t stop) {
+	Cache *c;
+	uint32_t i, line;
+	int core;
+
+	for (core = 0; core < NUM_CORES; core++) {
+		c = core == CURRENT_CORE ? &L1Cache : &CORES[core].L1Cache;
+		for (i = 0; i < NUM_CACHE_BLOCKS; i++) {
+			line = (c->blocks[i].tag << 4) | i;
+			if (line >= start >> 4 && line <= stop >> 4) {
+				c->blocks[i].valid = 0;
+			}
+		}
+		for (i = 0; i < MAX_VICTIM_ENTRIES; i++) {
+			if (VICTIM[core][i].line >= start >> 4 && VICTIM[core][i].line <= stop >> 4) {
+				VICTIM[core][i].valid = FALSE;
+			}
+		}
+	}
+}
+
+/* Read a whole file; returns NULL (after saying why) on failure */
+uint8_t *memio_slurp(const char *path, uint32_t *len) {
+	FILE *fp = fopen(path, "rb");
+	uint8_t *buf;
+	long size;
+
+	if (fp == NULL) {
+		printf("Error: Can't open %s\n", path);
+		return NULL;
+	}
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	rewind(fp);
+	buf = malloc(size > 0 ? size : 1);
+	if (size < 0 || fread(buf, 1, size, fp) != (size_t)size) {
+		printf("Error: Can't read %s\n", path);
+		free(buf);
+		fclose(fp);
+		return NULL;
+	}
+	fclose(fp);
+	*len = size;
+	return buf;
+}
+
+/***************************************************************/
+/* Write the words [start, stop] to path: raw little-endian    */
+/* bytes, or "<addr>: <word> x4" lines when path ends in .hex  */
+/***************************************************************/
+void memio_save(uint32_t start, uint32_t stop, const char *path) {
+	static const char digits[] = "0123456789abcdef";
+	FILE *fp;
+	uint8_t *buf;
+	char *text, *t;
+	uint32_t len = stop - start + 4, i, w;
+	int k, hex = strlen(path) > 4 && strcmp(path + strlen(path) - 4, ".hex") == 0;
+
+	if (stop < start) {
+		printf("Error: empty range\n");
+		return;
+	}
+	if ((fp = fopen(path, hex ? "w" : "wb")) == NULL) {
+		printf("Error: Can't open %s\n", path);
+		return;
+	}
+	buf = malloc(len);
+	memio_read(start, buf, len);
+	if (!hex) {
+		fwrite(buf, 1, len, fp);
+	}
+	else {
+		text = malloc((len / 16 + 1) * 48);
+		for (t = text, i = 0; i < len; i += 4) {
+			if (i % 16 == 0) {
+				t += sprintf(t, "%s%08x:", i ? "\n" : "", start + i);
+			}
+			w = buf[i] | buf[i + 1] << 8 | buf[i + 2] << 16 | (uint32_t)buf[i + 3] << 24;
+			*t++ = ' ';
+			for (k = 28; k >= 0; k -= 4) {
+				*t++ = digits[(w >> k) & 0xF];
+			}
+		}
+		*t++ = '\n';
+		fwrite(text, 1, t - text, fp);
+		free(text);
+	}
+	fclose(fp);
+	free(buf);
+	printf("Saved 0x%08x..0x%08x (%u bytes) to %s\n", start, stop, len, path);
+}
+
+/* Copy the file at path into guest memory from addr; FALSE when it does not fit */
+int memio_load(uint32_t addr, const char *path) {
+	uint32_t len, avail, done, n;
+	uint8_t *buf, *p;
+
+	if ((buf = memio_slurp(path, &len)) == NULL) {
+		return FALSE;
+	}
+	for (done = 0; done < len; done += n) {
+		p = mem_span(addr + done, &avail);
+		if (p == NULL) {
+			printf("Error: %s does not fit: 0x%08x is unmapped\n", path, addr + done);
+			free(buf);
+			return FALSE;
+		}
+		n = len - done < avail ? len - done : avail;
+		memcpy(p, buf + done, n);
+	}
+	free(buf);
+	if (len) {
+		memio_invalidate(addr, addr + len - 1);
+	}
+	printf("Loaded %u bytes from %s at 0x%08x\n", len, path, addr);
+	return TRUE;
+}
+
+/***************************************************************/
+/* Report the word ranges in which a and b (len bytes, guest   */
+/* address base) differ; equal pages cost one memcmp each      */
+/***************************************************************/
+void memio_diff(const uint8_t *a, const uint8_t *b, uint32_t len, uint32_t base) {
+	uint32_t page, i, end, first = 0, words = 0, ranges = 0, total = 0;
+	int open = FALSE;
+
+	printf("-------------------------------------------------------------\n");
+	printf("[Start]\t\t[End]\t\t[Words]\n");
+	printf("-------------------------------------------------------------\n");
+	for (page = 0; page < len; page += MEMIO_PAGE) {
+		end = len - page < MEMIO_PAGE ? len : page + MEMIO_PAGE;
+		if (!open && memcmp(a + page, b + page, end - page) == 0) {
+			continue;
+		}
+		for (i = page; i < end; i += 4) {
+			if (memcmp(a + i, b + i, len - i < 4 ? len - i : 4) != 0) {
+				if (!open) {
+					first = i;
+					words = 0;
+					open = TRUE;
+				}
+				words++;
+			}
+			else if (open) {
+				printf("0x%08x\t0x%08x\t%u\n", base + first, base + i - 4, words);
+				ranges++;
+				total += words;
+				open = FALSE;
+			}
+		}
+	}
+	if (open) {
+		printf("0x%08x\t0x%08x\t%u\n", base + first, base + ((len - 1) & ~3), words);
+		ranges++;
+		total += words;
+	}
+	printf("-------------------------------------------------------------\n");
+	printf("%u range%s, %u word%s differ\n", ranges, ranges == 1 ? "" : "s", total, total == 1 ? "" : "s");
+}
+
+/* Compare the dump at path with live guest memory from addr */
+void memio_diff_live(uint32_t addr, const char *path) {
+	uint32_t len;
+	uint8_t *dump, *live;
+
+	if ((dump = memio_slurp(path, &len)) == NULL) {
+		return;
+	}
+	live = malloc(len > 0 ? len : 1);
+	memio_read(addr, live, len);
+	memio_diff(dump, live, len, addr);
+	free(live);
+	free(dump);
+}
+
+/* Compare two dumps taken at the same guest address */
+void memio_diff_files(uint32_t addr, const char *path_a, const char *path_b) {
+	uint32_t len_a, len_b;
+	uint8_t *a, *b;
+
+	if ((a = memio_slurp(path_a, &len_a)) == NULL) {
+		return;
+	}
+	if ((b = memio_slurp(path_b, &len_b)) == NULL) {
+		free(a);
+		return;
+	}
+	if (len_a != len_b) {
+		printf("Note: %s is %u bytes, %s is %u; comparing the first %u\n", path_a, len_a, path_b, len_b,
+			len_a < len_b ? len_a : len_b);
+	}
+	memio_diff(a, b, len_a < len_b ? len_a : len_b, addr);
+	free(a);
+	free(b);
+}
+
+/* Load the -L blobs again after reset() cleared memory */
+void memio_reload() {
+	int i;
+
+	for (i = 0; i < MEMIO_NUM_IMPORTS; i++) {
+		memio_load(MEMIO_IMPORTS[i].addr, MEMIO_IMPORTS[i].path);
+	}
+}
@@ -3,8 +3,30 @@
 #include <string.h>
 #include <stdint.h>
 #include <assert.h>
+#include <getopt.h>
 #include "mu-mips.h"
 #include "mu-cache.h"
+#include "mu-perf.h"
+#include "mu-profile.h"
+#include "mu-host.h"
+#include "mu-telemetry.h"
+#include "mu-debug.h"
+#include "mu-multicore.h"
+#include "mu-victim.h"
+#include "mu-parallel.h"
+#include "mu-prefetch.h"
+#include "mu-mshr.h"
+#include "mu-dram.h"
+#include "mu-funit.h"
+#include "mu-syscall.h"
+#include "mu-reuse.h"
+#include "mu-superscalar.h"
+#include "mu-ooo.h"
+#include "mu-event.h"
+#include "mu-memio.h"
+#include "mu-stats.h"
+#include "mu-fork.h"
+#include "mu-interval.h"
 
 /***************************************************************/
 /* Print out a list of commands available                                                                  */
@@ -15,13 +37,39 @@ void help() {
 	printf("sim\t-- simulate program to completion \n");
 	printf("run <n>\t-- simulate program for <n> instructions\n");
 	printf("rdump\t-- dump register values\n");
+	printf("reuse\t-- print reuse-distance histograms, working set and per-region footprint (set reuse 1 first)\n");
 	printf("reset\t-- clears all registers/memory and re-loads the program\n");
 	printf("input <reg> <val>\t-- set GPR <reg> to <val>\n");
 	printf("mdump <start> <stop>\t-- dump memory from <start> to <stop> address\n");
+	printf("msave <start> <stop> <file>\t-- write memory from <start> to <stop> to <file>, as hex text if it ends in .hex\n");
+	printf("mload <addr> <file>\t-- copy the binary <file> into memory at <addr>\n");
+	printf("mdiff <addr> <file>\t-- list the ranges where memory at <addr> differs from the binary dump <file>\n");
+	printf("mcmp <addr> <file> <file>\t-- list the ranges where two binary dumps taken at <addr> differ\n");
 	printf("high <val>\t-- set the HI register to <val>\n");
 	printf("low <val>\t-- set the LO register to <val>\n");
 	printf("print\t-- print the program loaded into memory\n");
 	printf("show\t-- print the current content of the pipeline registers\n");
+	printf("perf\t-- print performance counters and the CPI stack\n");
+	printf("profile <n>\t-- print the <n> hottest PCs grouped by basic block\n");
+	printf("prefetch\t-- print prefetcher accuracy, coverage and lateness\n");
+	printf("victim\t-- print victim/miss cache statistics\n");
+	printf("mshr\t-- print MSHR usage and memory-level parallelism\n");
+	printf("dram\t-- print DRAM row-buffer hit rate, latency and bandwidth\n");
+	printf("superscalar\t-- print issue-slot utilization and IPC of the dual-issue pipeline\n");
+	printf("units\t-- print multiplier/divider latency, occupancy and HI/LO interlock stalls\n");
+	printf("ooo\t-- print ROB occupancy, dispatch stalls and mispredictions of the out-of-order backend\n");
+	printf("core <i>\t-- show core <i> in rdump/show and direct input/high/low/pc to it\n");
+	printf("pc <addr>\t-- set the PC of the selected core\n");
+	printf("coherence\t-- print per-core execution and MESI coherence statistics\n");
+	printf("break <addr>\t-- stop run/sim before the instruction at <addr> is fetched\n");
+	printf("watch <addr> <r|w|rw>\t-- stop run/sim after a load and/or store touches the word at <addr>\n");
+	printf("delete <addr|all>\t-- remove the breakpoint and watchpoint at <addr>, or all of them\n");
+	printf("breakpoints\t-- list breakpoints and watchpoints\n");
+	printf("flush\t-- write out guest output buffered by print syscalls\n");
+	printf("intervals <k> <w>\t-- run to completion functionally, simulating each <k>-instruction interval in detail in parallel after <w> warm-up instructions, and sum\n");
+	printf("fork <n> <cfg>...\t-- clone the simulation <n> times, run each clone for up to fork_cycles cycles with <param>=<val>[,...] applied (- = as is) and compare\n");
+	printf("telemetry <dest> <n>\t-- stream interval stats every <n> cycles to a file or unix:<socket>, 0 = stop\n");
+	printf("set <param> <val>\t-- set a simulator parameter (forwarding, miss_penalty, trace, host_stages, host_perf, telemetry, cores, quantum, prefetch, prefetch_degree, victim, miss_cache, mshrs, dram, dram_channels, dram_ranks, dram_banks, dram_policy, dram_trcd, dram_tcas, dram_trp, issue_width, ooo, ooo_width, ooo_rob, ooo_rs, ooo_lsq, mul_latency, mul_pipelined, div_latency, div_pipelined, event_driven, jobs, fork_cycles, reuse, reuse_window)\n");
 	printf("?\t-- display help menu\n");
 	printf("quit\t-- exit the simulator\n\n");
 	printf("------------------------------------------------------------------\n\n");
@@ -64,13 +112,29 @@ void mem_write_32(uint32_t address, uint32_t value)
 	}
 }
 
+/***************************************************************/
+/* Execute one cycle of the core in the globals: PIPELINE is   */
+/* the backend pipeline_select() picked for the current modes  */
+/***************************************************************/
+void core_cycle() {
+	MSHR_STATE[CURRENT_CORE].now++;
+	FU_STATE[CURRENT_CORE].now++;
+	EVENT_CORE[CURRENT_CORE].idle = FALSE;
+	PIPELINE();
+}
+
 /***************************************************************/
 /* Execute one cycle                                                                                                              */
 /***************************************************************/
 void cycle() {                                                
-	handle_pipeline();
-	CURRENT_STATE = NEXT_STATE;
+	if (NUM_CORES > 1) {
+		multicore_cycle();
+	}
+	else {
+		core_cycle();
+	}
 	CYCLE_COUNT++;
+	TELEMETRY_TICK();
 }
 
 /***************************************************************/
@@ -85,13 +149,25 @@ void run(int num_cycles) {
 
 	printf("Running simulator for %d cycles...\n\n", num_cycles);
 	int i;
+	host_run_begin();
+	pipeline_select();
+	if (parallel_enabled()) {
+		parallel_run(num_cycles);
+		host_run_end();
+		return;
+	}
 	for (i = 0; i < num_cycles; i++) {
 		if (RUN_FLAG == FALSE) {
 			printf("Simulation Stopped.\n\n");
 			break;
 		}
 		cycle();
+		i += event_skip(num_cycles - i - 1);
+		if (BREAK_ACTIVE && break_check()) {
+			break;
+		}
 	}
+	host_run_end();
 }
 
 /***************************************************************/
@@ -104,10 +180,24 @@ void runAll() {
 	}
 
 	printf("Simulation Started...\n\n");
+	host_run_begin();
+	pipeline_select();
+	if (parallel_enabled()) {
+		parallel_run(0);
+		printf("Simulation Finished.\n\n");
+		host_run_end();
+		return;
+	}
 	while (RUN_FLAG){
 		cycle();
+		event_skip(EVENT_NONE);
+		if (BREAK_ACTIVE && break_check()) {
+			host_run_end();
+			return;
+		}
 	}
 	printf("Simulation Finished.\n\n");
+	host_run_end();
 }
 
 /***************************************************************/ 
@@ -149,6 +239,119 @@ void rdump() {
 	printf("-------------------------------------\n");
 }
 
+/***************************************************************/
+/* Set a named simulator parameter                             */
+/***************************************************************/
+void set_param(const char *name, int value) {
+	if (strcmp(name, "forwarding") == 0){
+		ENABLE_FORWARDING = value != 0;
+		ENABLE_FORWARDING == 0 ? printf("Forwarding OFF\n") : printf("Forwarding ON\n");
+	}
+	else if (strcmp(name, "miss_penalty") == 0){
+		CACHE_MISS_PENALTY = value;
+		printf("Cache miss penalty: %u cycles\n", CACHE_MISS_PENALTY);
+	}
+	else if (strcmp(name, "trace") == 0){
+		TRACE_LEVEL = value;
+	}
+	else if (strcmp(name, "host_stages") == 0){
+		HOST_STAGE_SAMPLE = value;
+		HOST_STAGE_SAMPLE == 0 ? printf("Host stage timing OFF\n") : printf("Host stage timing: 1 in %u cycles\n", HOST_STAGE_SAMPLE);
+	}
+	else if (strcmp(name, "host_perf") == 0){
+		HOST_PERF = value;
+		HOST_PERF == 0 ? printf("Host PMU counters OFF\n") : printf("Host PMU counters ON\n");
+	}
+	else if (strcmp(name, "cores") == 0){
+		multicore_init(value);
+		printf("Cores: %d\n", NUM_CORES);
+	}
+	else if (strcmp(name, "prefetch") == 0){
+		if (value < 0 || value >= NUM_PREFETCHERS){
+			printf("Prefetcher must be 0 (none), 1 (next-line), 2 (stride) or 3 (stream)\n");
+			return;
+		}
+		PREFETCHER = value;
+		prefetch_reset();
+		printf("Prefetcher: %s\n", PREFETCHER_NAMES[PREFETCHER]);
+	}
+	else if (strcmp(name, "prefetch_degree") == 0){
+		PREFETCH_DEGREE = value > 0 ? value : 1;
+		printf("Prefetch degree: %u\n", PREFETCH_DEGREE);
+	}
+	else if (strcmp(name, "victim") == 0 || strcmp(name, "miss_cache") == 0){
+		if (value < 0 || value > MAX_VICTIM_ENTRIES){
+			printf("Victim/miss cache size must be between 0 and %d entries\n", MAX_VICTIM_ENTRIES);
+			return;
+		}
+		VICTIM_ENTRIES = value;
+		VICTIM_MODE = strcmp(name, "victim") == 0 ? VICTIM_CACHE : MISS_CACHE;
+		victim_reset();
+		VICTIM_ENTRIES == 0 ? printf("Victim/miss cache OFF\n") : printf("%s: %u entries\n", VICTIM_MODE == VICTIM_CACHE ? "Victim cache" : "Miss cache", VICTIM_ENTRIES);
+	}
+	else if (strcmp(name, "mshrs") == 0){
+		if (value < 0 || value > MAX_MSHRS){
+			printf("Number of MSHRs must be between 0 and %d\n", MAX_MSHRS);
+			return;
+		}
+		MSHR_COUNT = value;
+		mshr_reset();
+		MSHR_COUNT == 0 ? printf("Blocking cache\n") : printf("Non-blocking cache: %u MSHRs\n", MSHR_COUNT);
+	}
+	else if (strncmp(name, "dram", 4) == 0){
+		dram_set(name, value);
+	}
+	else if (strncmp(name, "mul_", 4) == 0 || strncmp(name, "div_", 4) == 0){
+		fu_set(name, value);
+	}
+	else if (strncmp(name, "ooo", 3) == 0){
+		ooo_set(name, value);
+	}
+	else if (strncmp(name, "reuse", 5) == 0){
+		reuse_set(name, value);
+	}
+	else if (strcmp(name, "event_driven") == 0){
+		EVENT_DRIVEN = value != 0;
+		event_reset();
+		printf("Event-driven kernel %s\n", EVENT_DRIVEN ? "ON: idle cycles are skipped" : "OFF: every cycle is stepped");
+	}
+	else if (strcmp(name, "issue_width") == 0){
+		if (value < 1 || value > MAX_ISSUE_WIDTH){
+			printf("Issue width must be between 1 and %d\n", MAX_ISSUE_WIDTH);
+			return;
+		}
+		pipeline_flush();
+		ISSUE_WIDTH = value;
+		ss_reset();
+		printf("Issue width: %u (%s)\n", ISSUE_WIDTH, ISSUE_WIDTH > 1 ? "in-order superscalar" : "scalar pipeline");
+	}
+	else if (strcmp(name, "quantum") == 0){
+		PARALLEL_QUANTUM = value;
+		PARALLEL_QUANTUM == 0 ? printf("Serial multi-core engine\n") : printf("Parallel multi-core engine, quantum %u cycles%s\n", PARALLEL_QUANTUM, PARALLEL_QUANTUM == 1 ? " (lockstep)" : "");
+	}
+	else if (strcmp(name, "jobs") == 0){
+		INTERVAL_JOBS = value > 0 ? value : 0;
+		INTERVAL_JOBS == 0 ? printf("Interval jobs: one per host CPU\n") : printf("Interval jobs: %u\n", INTERVAL_JOBS);
+	}
+	else if (strcmp(name, "fork_cycles") == 0){
+		if (value < 1){
+			printf("fork_cycles must be at least 1\n");
+			return;
+		}
+		FORK_MAX_CYCLES = value;
+		printf("Forked children stop after %u cycles\n", FORK_MAX_CYCLES);
+	}
+	else if (strcmp(name, "telemetry") == 0){
+		TELEMETRY_INTERVAL = value;
+		if (TELEMETRY_DEST[0] != '\0'){
+			telemetry_start(TELEMETRY_DEST, TELEMETRY_INTERVAL);
+		}
+	}
+	else {
+		printf("Unknown parameter: %s\n", name);
+	}
+}
+
 /***************************************************************/
 /* Read a command from standard input.                                                               */  
 /***************************************************************/
@@ -158,11 +361,21 @@ void handle_command() {
 	uint32_t register_no;
 	int register_value;
 	int hi_reg_value, lo_reg_value;
+	char param[32];
+	int param_value;
+	char dest[108], path[108];
+	uint32_t interval, addr;
+	int core;
+	char arg[20];
+	int top_n;
 
-	printf("MU-MIPS SIM:> ");
+	if (!BATCH_MODE){
+		syscall_flush();
+		printf("MU-MIPS SIM:> ");
+	}
 
-	if (scanf("%s", buffer) == EOF){
-		exit(0);
+	if (scanf("%19s", buffer) == EOF){
+		sim_exit();
 	}
 
 	switch(buffer[0]) {
@@ -170,12 +383,47 @@ void handle_command() {
 		case 's':
 			if (buffer[1] == 'h' || buffer[1] == 'H'){
 				show_pipeline();
+			}else if (buffer[1] == 'u' || buffer[1] == 'U'){
+				ss_dump();
+			}else if (buffer[1] == 'e' || buffer[1] == 'E'){
+				if (scanf("%31s %i", param, &param_value) != 2){
+					break;
+				}
+				set_param(param, param_value);
 			}else {
 				runAll(); 
 			}
 			break;
 		case 'M':
 		case 'm':
+			if (strcmp(buffer, "msave") == 0){
+				if (scanf("%x %x %107s", &start, &stop, dest) == 3){
+					memio_save(start, stop, dest);
+				}
+				break;
+			}
+			if (strcmp(buffer, "mload") == 0){
+				if (scanf("%x %107s", &addr, dest) == 2){
+					memio_load(addr, dest);
+				}
+				break;
+			}
+			if (strcmp(buffer, "mdiff") == 0){
+				if (scanf("%x %107s", &addr, dest) == 2){
+					memio_diff_live(addr, dest);
+				}
+				break;
+			}
+			if (strcmp(buffer, "mcmp") == 0){
+				if (scanf("%x %107s %107s", &addr, dest, path) == 3){
+					memio_diff_files(addr, dest, path);
+				}
+				break;
+			}
+			if (buffer[1] == 's' || buffer[1] == 'S'){
+				mshr_dump();
+				break;
+			}
 			if (scanf("%x %x", &start, &stop) != 2){
 				break;
 			}
@@ -186,13 +434,17 @@ void handle_command() {
 			break;
 		case 'Q':
 		case 'q':
-			printf("**************************\n");
-			printf("Exiting MU-MIPS! Good Bye...\n");
-			printf("**************************\n");
-			exit(0);
+			if (!BATCH_MODE){
+				printf("**************************\n");
+				printf("Exiting MU-MIPS! Good Bye...\n");
+				printf("**************************\n");
+			}
+			sim_exit();
 		case 'R':
 		case 'r':
-			if (buffer[1] == 'd' || buffer[1] == 'D'){
+			if (strcmp(buffer, "reuse") == 0){
+				reuse_dump();
+			}else if (buffer[1] == 'd' || buffer[1] == 'D'){
 				rdump();
 			}else if(buffer[1] == 'e' || buffer[1] == 'E'){
 				reset();
@@ -206,6 +458,12 @@ void handle_command() {
 			break;
 		case 'I':
 		case 'i':
+			if (strcmp(buffer, "intervals") == 0){
+				if (scanf("%u %u", &interval, &addr) == 2){
+					interval_run(interval, addr);
+				}
+				break;
+			}
 			if (scanf("%u %i", &register_no, &register_value) != 2){
 				break;
 			}
@@ -230,12 +488,123 @@ void handle_command() {
 			break;
 		case 'P':
 		case 'p':
-			print_program(); 
+			if (buffer[1] == 'e' || buffer[1] == 'E'){
+				perf_dump();
+			}else if (buffer[1] == 'c' || buffer[1] == 'C'){
+				if (scanf("%x", &addr) != 1){
+					break;
+				}
+				CURRENT_STATE.PC = addr;
+				NEXT_STATE.PC = addr;
+			}else if (buffer[2] == 'e' || buffer[2] == 'E'){
+				prefetch_dump();
+			}else if (buffer[2] == 'o' || buffer[2] == 'O'){
+				if (scanf("%d", &top_n) != 1){
+					break;
+				}
+				profile_dump(top_n);
+			}else {
+				print_program(); 
+			}
+			break;
+		case 'C':
+		case 'c':
+			if (buffer[2] == 'h' || buffer[2] == 'H'){
+				multicore_dump();
+				break;
+			}
+			if (scanf("%d", &core) != 1){
+				break;
+			}
+			if (core < 0 || core >= NUM_CORES){
+				printf("No core %d (%d cores)\n", core, NUM_CORES);
+				break;
+			}
+			core_switch(core);
+			printf("Core %d selected\n", CURRENT_CORE);
+			break;
+		case 'B':
+		case 'b':
+			if (buffer[5] == 'p' || buffer[5] == 'P'){
+				break_list();
+				break;
+			}
+			if (scanf("%x", &addr) != 1){
+				break;
+			}
+			break_set(addr);
+			break;
+		case 'W':
+		case 'w':
+			if (scanf("%x %3s", &addr, arg) != 2){
+				break;
+			}
+			watch_set(addr, (strchr(arg, 'r') ? WATCH_READ : 0) | (strchr(arg, 'w') ? WATCH_WRITE : 0));
+			break;
+		case 'D':
+		case 'd':
+			if (buffer[1] == 'r' || buffer[1] == 'R'){
+				dram_dump();
+				break;
+			}
+			if (scanf("%19s", arg) != 1){
+				break;
+			}
+			if (strcmp(arg, "all") == 0){
+				break_delete_all();
+			}else {
+				break_delete(strtoul(arg, NULL, 16));
+			}
+			break;
+		case 'V':
+		case 'v':
+			victim_dump();
+			break;
+		case 'O':
+		case 'o':
+			ooo_dump();
+			break;
+		case 'U':
+		case 'u':
+			fu_dump();
+			break;
+		case 'T':
+		case 't':
+			if (scanf("%107s %u", dest, &interval) != 2){
+				break;
+			}
+			telemetry_start(dest, interval);
+			if (TELEMETRY_RUNNING){
+				printf("Telemetry: every %u cycles to %s\n", TELEMETRY_INTERVAL, TELEMETRY_DEST);
+			}
 			break;
 		case 'f':
+			if (strcmp(buffer, "fork") == 0){
+				if (scanf("%d", &top_n) != 1){
+					break;
+				}
+				if (top_n < 1 || top_n > FORK_MAX_CHILDREN){
+					printf("Between 1 and %d children\n", FORK_MAX_CHILDREN);
+					break;
+				}
+				for (core = 0; core < top_n; core++){
+					if (scanf("%107s", FORK_SPECS[core]) != 1){
+						break;
+					}
+				}
+				if (core == top_n){
+					fork_run(FORK_SPECS, top_n);
+				}
+				break;
+			}
+			if (buffer[1] == 'l' || buffer[1] == 'L'){
+				syscall_flush();
+				break;
+			}
 			if (scanf("%d", &ENABLE_FORWARDING) != 1) {
 				break;
 			}
+			ENABLE_FORWARDING = ENABLE_FORWARDING != 0;
 			ENABLE_FORWARDING == 0 ? printf("Forwarding OFF\n") : printf("Forwarding ON\n"); break;
 		default:
 			printf("Invalid Command.\n");
@@ -262,12 +631,33 @@ void reset() {
 
 	/*load program*/
 	load_program();
+	memio_reload();
 
 	/*reset PC*/
 	INSTRUCTION_COUNT = 0;
+	CYCLE_COUNT = 0;
+	perf_reset();
+	telemetry_rebase();
+	WATCH_HIT = 0;
+	BREAK_STOPPED_PC = BREAK_NONE;
+	prefetch_reset();
+	victim_reset();
+	mshr_reset();
+	dram_reset();
+	fu_reset();
+	reuse_reset();
+	ss_reset();
+	ooo_reset();
+	event_reset();
+	syscall_reset();
 	CURRENT_STATE.PC =  MEM_TEXT_BEGIN;
 	NEXT_STATE = CURRENT_STATE;
+	pipeline_clear();
 	RUN_FLAG = TRUE;
+	// every core starts from the state above, so it must be complete before it is copied
+	if (NUM_CORES > 1){
+		multicore_init(NUM_CORES);
+	}
 }
 
 /***************************************************************/
@@ -303,2012 +693,454 @@ void load_program() {
 	while( fscanf(fp, "%x\n", &word) != EOF ) {
 		address = MEM_TEXT_BEGIN + i;
 		mem_write_32(address, word);
-		printf("writing 0x%08x into address 0x%08x (%d)\n", word, address, address);
+		TRACE("writing 0x%08x into address 0x%08x (%d)\n", word, address, address);
 		i += 4;
 	}
 	PROGRAM_SIZE = i/4;
-	printf("Program loaded into memory.\n%d words written into memory.\n\n", PROGRAM_SIZE);
+	if (!BATCH_MODE){
+		printf("Program loaded into memory.\n%d words written into memory.\n\n", PROGRAM_SIZE);
+	}
 	fclose(fp);
+	profile_reset();
+	break_resize();
 }
 
 /************************************************************/
-/* maintain the pipeline                                                                                           */ 
+/* The stage bodies below are written once and instantiated */
+/* per mode: their parameters shadow the globals of the     */
+/* same name, so a variant that passes constants has the    */
+/* forwarding, trace and memory-model tests folded away     */
 /************************************************************/
-void handle_pipeline()
-{
-	/*INSTRUCTION_COUNT should be incremented when instruction is done*/
-	/*Since we do not have branch/jump instructions, INSTRUCTION_COUNT should be incremented in WB stage */
-
-	WB();
-	MEM();
-	EX();
-	ID();
-	IF();
-}
+#define STAGE static inline __attribute__((always_inline)) void
+#define STAGE_MODES const int ENABLE_FORWARDING, const int TRACE_LEVEL, const int MEM_MODELS
 
 /************************************************************/
-/* writeback (WB) pipeline stage:                                                                          */ 
+/* Everything that watches the data side after the MEM     */
+/* stage handled instruction ir at pc; models is FALSE when */
+/* none of the optional memory models is configured         */
 /************************************************************/
-void WB()
+static inline __attribute__((always_inline)) void mem_access_hooks(uint32_t ir, uint32_t pc, uint32_t addr, int missed, const int models)
 {
-	/*IMPLEMENT THIS*/
-	uint32_t opcode, function, rd, rt;
-
-	opcode = (MEM_WB.IR & 0xFC000000) >> 26;
-	function = MEM_WB.IR & 0x0000003F;
-	rt = (MEM_WB.IR & 0x001F0000) >> 16;
-	rd = (MEM_WB.IR & 0x0000F800) >> 11;
+	uint32_t opcode = (ir & 0xFC000000) >> 26;
 
-	//printf("%u\n", MEM_WB.IR);
-
-	if(opcode == 0x00 && MEM_WB.IR != 0){
-		switch(function){
-			case 0x00: //SLL
-				NEXT_STATE.REGS[rd] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rd;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x01:
-				IF_EX.FLAG = TRUE;
-				INSTRUCTION_COUNT--;
-				//printf("Set IF_EX.FLAG = TRUE.\n");
-                print_instruction(CURRENT_STATE.PC - 12);
-				break;
-			case 0x02: //SRL
-				NEXT_STATE.REGS[rd] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rd;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x03: //SRA 
-				NEXT_STATE.REGS[rd] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rd;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-            case 0x08: //JR
-                branch_taken = FALSE; // Reset flag
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-            case 0x09: //JALR
-				NEXT_STATE.REGS[rd] = MEM_WB.ALUOutput + 4;
-                branch_taken = FALSE; // Reset flag
-			case 0x0C: //SYSCALL
-				if(MEM_WB.ALUOutput == 0xa){
-					RUN_FLAG = FALSE;
-				}
-                MEM_WB.RegisterRd = rd;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x10: //MFHI
-				CURRENT_STATE.REGS[rd] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rd;
-                //printf("MEM_WB.RegisterRd: %u", MEM_WB.RegisterRd);
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x11: //MTHI
-				NEXT_STATE.HI = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rd;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x12: //MFLO
-				NEXT_STATE.REGS[rd] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rd;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x13: //MTLO
-				NEXT_STATE.LO = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = 33;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x18: //MULT
-				NEXT_STATE.LO = (MEM_WB.AA & 0x00000000FFFFFFFF);
-				NEXT_STATE.HI = (MEM_WB.AA & 0XFFFFFFFF00000000) >> 32;
-				MEM_WB.RegisterRd = rd;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x19: //MULTU
-				NEXT_STATE.LO = (MEM_WB.AA & 0x00000000FFFFFFFF);
-				NEXT_STATE.HI = (MEM_WB.AA & 0XFFFFFFFF00000000) >> 32;
-				MEM_WB.RegisterRd = rd;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x1A: //DIV 
-				NEXT_STATE.LO = MEM_WB.ALUOutput;
-				NEXT_STATE.HI = MEM_WB.A;
-				MEM_WB.RegisterRd = rd;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x1B: //DIVU
-				NEXT_STATE.LO = MEM_WB.ALUOutput;
-				NEXT_STATE.HI = MEM_WB.A;
-				MEM_WB.RegisterRd = rd;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x20: //ADD
-				NEXT_STATE.REGS[rd] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rd;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x21: //ADDU 
-				NEXT_STATE.REGS[rd] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rd;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x22: //SUB
-				NEXT_STATE.REGS[rd] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rd;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x23: //SUBU
-				NEXT_STATE.REGS[rd] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rd;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x24: //AND
-				NEXT_STATE.REGS[rd] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rd;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x25: //OR
-				NEXT_STATE.REGS[rd] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rd;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x26: //XOR
-				NEXT_STATE.REGS[rd] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rd;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x27: //NOR
-				NEXT_STATE.REGS[rd] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rd;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x2A: //SLT
-				NEXT_STATE.REGS[rd] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rd;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			default:
-				printf("WB at 0x%x is not implemented!\n", CURRENT_STATE.PC);
-				INSTRUCTION_COUNT--;
-				break;
-		}
+	if (missed){
+		profile_dmiss(pc);
 	}
-	else{
-		switch(opcode){
-            case 0x01:
-                branch_taken = FALSE; // Reset flag
-                print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x02: // J 
-				branch_taken = FALSE; // Reset flag
-                print_instruction(CURRENT_STATE.PC - 16);
-                break;
-            case 0x03: //JAL
-                branch_taken = FALSE; // Reset flag
-				NEXT_STATE.REGS[31] = MEM_WB.ALUOutput + 4;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-            case 0x04: //BEQ
-				branch_taken = FALSE; // Reset flag
-                //printf("Set branch_taken = false.\n");
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-            case 0x05: //BNE
-				branch_taken = FALSE; // Reset flag
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-            case 0x06: //BLEZ
-				branch_taken = FALSE; // Reset flag
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-            case 0x07: //BGTZ
-				branch_taken = FALSE; // Reset flag
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x08: //ADDI
-				NEXT_STATE.REGS[rt] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rt;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x09: //ADDIU
-				NEXT_STATE.REGS[rt] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rt;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x0A: //SLTI
-				NEXT_STATE.REGS[rt] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rt;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x0C: //ANDI
-				NEXT_STATE.REGS[rt] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rt;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x0D: //ORI
-				NEXT_STATE.REGS[rt] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rt;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x0E: //XORI
-				NEXT_STATE.REGS[rt] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rt;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x0F: //LUI
-				NEXT_STATE.REGS[rt] = MEM_WB.ALUOutput;
-				MEM_WB.RegisterRd = rt;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x20: //LB
-				NEXT_STATE.REGS[rt] = ((MEM_WB.LMD & 0x000000FF) & 0x80) > 0 ? (MEM_WB.LMD | 0xFFFFFF00) : (MEM_WB.LMD & 0x000000FF);
-				MEM_WB.RegisterRd = rt;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x21: //LH
-				NEXT_STATE.REGS[rt] = ((MEM_WB.LMD & 0x0000FFFF) & 0x8000) > 0 ? (MEM_WB.LMD | 0xFFFF0000) : (MEM_WB.LMD & 0x0000FFFF);
-				MEM_WB.RegisterRd = rt;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x23: //LW
-				CURRENT_STATE.REGS[rt] = MEM_WB.LMD;
-				MEM_WB.RegisterRd = rt;
-				//IF_EX.FLAG = TRUE;
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x28: //SB
-				printf("WB at 0x%x is not implemented!\n", CURRENT_STATE.PC);
-				MEM_WB.RegisterRd = rd;
-				//for count the instruction
-				print_instruction(CURRENT_STATE.PC - 16);				
-				break;
-			case 0x29: //SH
-				printf("WB at 0x%x is not implemented!\n", CURRENT_STATE.PC);
-				MEM_WB.RegisterRd = rd;
-				//for count the instruction
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			case 0x2B: //SW
-				printf("WB at 0x%x is not implemented!\n", CURRENT_STATE.PC);
-				MEM_WB.RegisterRd = rd;
-				//for count the instruction
-				print_instruction(CURRENT_STATE.PC - 16);
-				break;
-			default:
-				// put more things here
-				printf("WB at 0x%x is not implemented!\n", CURRENT_STATE.PC);
-				INSTRUCTION_COUNT--;
-				break;
-		}
+	WATCH_CHECK(opcode, addr, pc);
+	if (!models){
+		return;
 	}
-    if(MEM_WB.ff == FALSE){
-        IF_EX.FLAG = TRUE;
-        MEM_WB.ff = TRUE;
-    }
-	INSTRUCTION_COUNT++;
+	if (NUM_CORES > 1){
+		mesi_access(opcode, addr, missed);
+	}
+	if (PREFETCHER != PREFETCH_NONE){
+		prefetch_access(opcode, pc, addr, missed);
+	}
+	if (DRAM_ENABLED){
+		dram_access(opcode, addr);
+	}
+	if (MSHR_COUNT){
+		mshr_access(opcode, ir, addr, missed);
+	}
+	if (REUSE_ENABLED){
+		reuse_access(REUSE_DATA, addr);
+	}
+}
+
+void mem_access_done(uint32_t ir, uint32_t pc, uint32_t addr, int missed)
+{
+	mem_access_hooks(ir, pc, addr, missed, TRUE);
 }
 
 /************************************************************/
-/* memory access (MEM) pipeline stage:                                                          */ 
+/* Blocking cache: TRUE while the whole core waits for the  */
+/* line fill in flight                                      */
 /************************************************************/
-void MEM()
+static inline __attribute__((always_inline)) int mem_frozen()
 {
-	/*IMPLEMENT THIS*/
-	if (MEM_WB.FLAG == FALSE){
-		if (MEM_WB.RegWrite == 1 && (MEM_WB.RegisterRd != 0) && (MEM_WB.RegisterRd == ID_IF.RegisterRs)){
-			if(ENABLE_FORWARDING == 0){
-				//printf("MEM_WB.RegWrite: %d MEM_WB.RegisterRd: %d IF_EX.RegisterRs:%d\n", MEM_WB.RegWrite, MEM_WB.RegisterRd, IF_EX.RegisterRs);
-				IF_EX.FLAG = FALSE;
-				//MEM_WB.RegisterRd = 0;
-				//printf("flag3\n");
-				MEM_WB.IR = 0x00000001;
-                MEM_WB.ff = FALSE;
-			}
-			else{
-				if ((EX_MEM.RegWrite == 1 && (EX_MEM.RegisterRd == ID_IF.RegisterRs)) != 1){
-					//printf("MEM_WB.RegWrite: %d MEM_WB.RegisterRd: %d IF_EX.RegisterRs:%d\n", MEM_WB.RegWrite, MEM_WB.RegisterRd, IF_EX.RegisterRs);
-					//printf("EX_MEM.RegWrite: %d EX_MEM.RegisterRd: %d IF_EX.RegisterRs:%d\n", EX_MEM.RegWrite, EX_MEM.RegisterRd, IF_EX.RegisterRs);
-					ForwardA = 01;
-					//MEM_WB.RegisterRd = 0;
-					//printf("flag7\n");
-				}
-			}
-		}
-		if (MEM_WB.RegWrite == 1 && (MEM_WB.RegisterRd != 0) && (MEM_WB.RegisterRd == ID_IF.RegisterRt)){
-			if(ENABLE_FORWARDING == 0){
-				//printf("MEM_WB.RegWrite: %d MEM_WB.RegisterRd: %d IF_EX.RegisterRt:%d\n", MEM_WB.RegWrite, MEM_WB.RegisterRd, IF_EX.RegisterRt);
-				IF_EX.FLAG = FALSE;
-				//MEM_WB.RegisterRd = 0;
-				//printf("flag4\n");
-				MEM_WB.IR = 0x00000001;
-                MEM_WB.ff = FALSE;
-			}
-			else{
-				if ((EX_MEM.RegWrite == 1 && (EX_MEM.RegisterRd == ID_IF.RegisterRt)) != 1){
-					//printf("MEM_WB.RegWrite: %d MEM_WB.RegisterRd: %d IF_EX.RegisterRt:%d\n", MEM_WB.RegWrite, MEM_WB.RegisterRd, IF_EX.RegisterRt);
-					//printf("EX_MEM.RegWrite: %d EX_MEM.RegisterRd: %d IF_EX.RegisterRt:%d\n", EX_MEM.RegWrite, EX_MEM.RegisterRd, IF_EX.RegisterRt);
-					ForwardB = 01;
-					//MEM_WB.RegisterRd = 0;
-					//printf("flag8\n");
-				}
-			}
-		}
-		MEM_WB.FLAG = TRUE;
-		MEM_WB.RegisterRd = 0;
-	}
-	else {
-		if (MEM_WB.RegWrite == 1 && (MEM_WB.RegisterRd != 0) && (MEM_WB.RegisterRd == IF_EX.RegisterRs)){
-			if(ENABLE_FORWARDING == 0){
-				//printf("MEM_WB.RegWrite: %d MEM_WB.RegisterRd: %d IF_EX.RegisterRs:%d\n", MEM_WB.RegWrite, MEM_WB.RegisterRd, IF_EX.RegisterRs);
-				IF_EX.FLAG = FALSE;
-				//MEM_WB.RegisterRd = 0;
-				//printf("flag3\n");
-				MEM_WB.IR = 0x00000001;
-                MEM_WB.ff = FALSE; 
-			}
-			else{
-				if ((EX_MEM.RegWrite == 1 && (EX_MEM.RegisterRd == IF_EX.RegisterRs)) != 1){
-					//printf("MEM_WB.RegWrite: %d MEM_WB.RegisterRd: %d IF_EX.RegisterRs:%d\n", MEM_WB.RegWrite, MEM_WB.RegisterRd, IF_EX.RegisterRs);
-					//printf("EX_MEM.RegWrite: %d EX_MEM.RegisterRd: %d IF_EX.RegisterRs:%d\n", EX_MEM.RegWrite, EX_MEM.RegisterRd, IF_EX.RegisterRs);
-					ForwardA = 01;
-					//MEM_WB.RegisterRd = 0;
-					//printf("flag7\n");
-				}
-			}
-		}
-		if (MEM_WB.RegWrite == 1 && (MEM_WB.RegisterRd != 0) && (MEM_WB.RegisterRd == IF_EX.RegisterRt)){
-			if(ENABLE_FORWARDING == 0){
-				//printf("MEM_WB.RegWrite: %d MEM_WB.RegisterRd: %d IF_EX.RegisterRt:%d\n", MEM_WB.RegWrite, MEM_WB.RegisterRd, IF_EX.RegisterRt);
-				IF_EX.FLAG = FALSE;
-				//MEM_WB.RegisterRd = 0;
-				//printf("flag4\n");
-				MEM_WB.IR = 0x00000001;
-                MEM_WB.ff = FALSE; 
-			}
-			else{
-				if ((EX_MEM.RegWrite == 1 && (EX_MEM.RegisterRd == IF_EX.RegisterRt)) != 1){
-					//printf("MEM_WB.RegWrite: %d MEM_WB.RegisterRd: %d IF_EX.RegisterRt:%d\n", MEM_WB.RegWrite, MEM_WB.RegisterRd, IF_EX.RegisterRt);
-					//printf("EX_MEM.RegWrite: %d EX_MEM.RegisterRd: %d IF_EX.RegisterRt:%d\n", EX_MEM.RegWrite, EX_MEM.RegisterRd, IF_EX.RegisterRt);
-					ForwardB = 01;
-					//MEM_WB.RegisterRd = 0;
-					//printf("flag8\n");
-				}
-			}
-		}
-		MEM_WB.RegisterRd = 0;
+	if (MEM_STALL_CYCLES == 0){
+		return FALSE;
 	}
+	MEM_STALL_CYCLES--;
+	PERF_INC(PERF_CACHE_MISS_STALL);
+	PROFILE_PENDING_STALL++;
+	event_idle(PERF_CACHE_MISS_STALL, 0, MEM_STALL_CYCLES);
+	return TRUE;
+}
 
-        MEM_WB.IR = EX_MEM.IR;
+/************************************************************/
+/* TRUE while an in-order core stays frozen this cycle: on  */
+/* a blocking fill, on a register an outstanding fill will  */
+/* write (MSHRs), or on a busy multiplier/divider or HI/LO  */
+/* not written yet. Only the MEM_MODELS variants can see    */
+/* the first two                                            */
+/************************************************************/
+static inline __attribute__((always_inline)) int core_frozen(const int MEM_MODELS, const int WIDE)
+{
+	uint32_t waiting;
 
-	uint32_t opcode, function, data, rt, rd;
+	if (MEM_MODELS && mem_frozen()){
+		return TRUE;
+	}
+	if (MEM_MODELS && MSHR_COUNT && (WIDE ? ss_mshr_stall() : mshr_stall())){
+		PERF_INC(PERF_MSHR_STALL);
+		PROFILE_PENDING_STALL++;
+		event_idle(PERF_MSHR_STALL, 0, (WIDE ? ss_mshr_ready() : mshr_ready(pipeline_ex_ir())) - MSHR_STATE[CURRENT_CORE].now - 1);
+		return TRUE;
+	}
+	if (WIDE ? ss_fu_stall(&waiting) : fu_stall(&waiting)){
+		PROFILE_PENDING_STALL++;
+		event_idle(fu_unit(waiting) >= 0 ? PERF_FU_STALL : PERF_HILO_STALL, fu_unit(waiting),
+			fu_ready(waiting) - FU_STATE[CURRENT_CORE].now - 1);
+		return TRUE;
+	}
+	return FALSE;
+}
 
-	opcode = (MEM_WB.IR & 0xFC000000) >> 26;
-	function = MEM_WB.IR & 0x0000003F;
-	rt = (IF_EX.IR & 0x001F0000) >> 16;
-	rd = (IF_EX.IR & 0x0000F800) >> 11;
+/************************************************************/
+/* Hazard detection on the current latches: TRUE when the   */
+/* instruction in IF/ID has to wait there another cycle,    */
+/* with *cause the counter the lost slot is charged to. ID  */
+/* and IF both ask, so neither depends on the other running */
+/* first. A syscall retires before anything behind it       */
+/* reaches EX, since it writes $v0 from WB                  */
+/************************************************************/
+static inline __attribute__((always_inline)) int pipeline_hazard(const int ENABLE_FORWARDING, perf_counter_t *cause)
+{
+	const SS_Slot *s = &CURRENT_PIPE.IF_ID;
+	const SS_Slot *older[2] = { &CURRENT_PIPE.ID_EX, &CURRENT_PIPE.EX_MEM };
+	int i, j, k;
 
-	if(opcode == 0x00 && MEM_WB.IR != 0){
-		switch(function){
-			case 0x00: //SLL
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rd;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				// print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x02: //SRL
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rd;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x03: //SRA 
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rd;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-            case 0x08: //JR
-                EX_MEM.FLAG = FALSE;
-                branch_taken = TRUE; 
-				is_branch_jump = FALSE;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-            case 0x09: //JALR
-                EX_MEM.FLAG = FALSE;
-                MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-                branch_taken = TRUE; 
-				is_branch_jump = FALSE;
-			case 0x0C: //SYSCALL
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x10: //MFHI
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rd;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x11: //MTHI
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-                MEM_WB.HI = 1;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x12: //MFLO
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rd;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x13: //MTLO
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-                MEM_WB.LO = 1;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x18: //MULT
-				MEM_WB.AA = EX_MEM.AA;
-                MEM_WB.HI = 2;
-                MEM_WB.LO = 2;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x19: //MULTU
-				MEM_WB.AA = EX_MEM.AA;
-                MEM_WB.HI = 2;
-                MEM_WB.LO = 2;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x1A: //DIV 
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				MEM_WB.A = EX_MEM.A;
-                MEM_WB.HI = 3;
-                MEM_WB.LO = 3;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x1B: //DIVU
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				MEM_WB.A = EX_MEM.A;
-                MEM_WB.HI = 3;
-                MEM_WB.LO = 3;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x20: //ADD
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rd;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x21: //ADDU 
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rd;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x22: //SUB
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rd;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x23: //SUBU
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rd;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x24: //AND
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rd;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x25: //OR
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-                //printf("or: %u\n", MEM_WB.ALUOutput);
-				//MEM_WB.RegisterRd = rd;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x26: //XOR
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rd;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x27: //NOR
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rd;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x2A: //SLT
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rd;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			default:
-				printf("MEM at 0x%x is not implemented!\n", CURRENT_STATE.PC);
-				break;
-		}
+	if (!s->valid || CURRENT_PIPE.redirect){
+		return FALSE;
 	}
-	else{
-		switch(opcode){
-            case 0x01:
-				if(rt == 0x00000){ //BLTZ
-				    if((IF_EX.A & 0x80000000) > 0){
-                        EX_MEM.FLAG = FALSE;
-                        branch_taken = TRUE; 
-				        is_branch_jump = FALSE;
-				    }
-                    else{
-                        branch_not_taken = TRUE; 
-                        is_branch_jump = FALSE;
-                    }
-				//print_instruction(CURRENT_STATE.PC);
-				}
-				else if(rt == 0x00001){ //BGEZ
-				    if((IF_EX.A & 0x80000000) == 0x0){
-                        EX_MEM.FLAG = FALSE;
-                        branch_taken = TRUE; 
-				        is_branch_jump = FALSE;
-				    }
-                    else{
-                        branch_not_taken = TRUE; 
-                        is_branch_jump = FALSE;
-                    }
-				//print_instruction(CURRENT_STATE.PC);
-				}
-				break;
-			case 0x02: // J
-                EX_MEM.FLAG = FALSE;
-				branch_taken = TRUE; 
-				is_branch_jump = FALSE;
-                break;
-            case 0x03: //JAL
-                EX_MEM.FLAG = FALSE;
-                branch_taken = TRUE; 
-				is_branch_jump = FALSE;
-                MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-            case 0x04: //BEQ
-				if(IF_EX.A == IF_EX.B){
-                    EX_MEM.FLAG = FALSE;
-				    branch_taken = TRUE; 
-				    is_branch_jump = FALSE;
-                    //printf("BEQ TAKEN\n");
-                    //printf("is_branch_jump: %d", is_branch_jump);
-				}
-                else{
-                    //printf("BEQ NOT TAKEN\n");
-                    branch_not_taken = TRUE; 
-                    //EX_MEM.FLAG = FALSE;
-                    is_branch_jump = FALSE;
-                    //printf("is_branch_jump: %d", is_branch_jump);
-                }
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-            case 0x05: //BNE
-				if(IF_EX.A != IF_EX.B){
-                    EX_MEM.FLAG = FALSE;
-                    branch_taken = TRUE; 
-				    is_branch_jump = FALSE;
-				}
-                else{
-                    branch_not_taken = TRUE; 
-                    is_branch_jump = FALSE;
-                }
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-            case 0x06: //BLEZ
-				if((IF_EX.A & 0x80000000) > 0 || IF_EX.A == 0){
-                    EX_MEM.FLAG = FALSE;
-                    branch_taken = TRUE; 
-				    is_branch_jump = FALSE;
-				}
-                else{
-                    branch_not_taken = TRUE; 
-                    is_branch_jump = FALSE;
-                }
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-            case 0x07: //BGTZ
-				if((IF_EX.A & 0x80000000) == 0x0 || IF_EX.A != 0){
-                    EX_MEM.FLAG = FALSE;
-                    branch_taken = TRUE; 
-				    is_branch_jump = FALSE;
-				}
-                else{
-                    branch_not_taken = TRUE; 
-                    is_branch_jump = FALSE;
-                }
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x08: //ADDI
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rt;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x09: //ADDIU
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rt;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x0A: //SLTI
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rt;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x0C: //ANDI
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rt;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x0D: //ORI
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rt;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x0E: //XORI
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rt;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x0F: //LUI
-				MEM_WB.ALUOutput = EX_MEM.ALUOutput;
-				//MEM_WB.RegisterRd = rt;
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x20: //LB
-				 if(1 == cache_isHit(EX_MEM.ALUOutput)) {
-					MEM_WB.LMD = cache_read_32(EX_MEM.ALUOutput);
-				 }
-				 else { // Miss -- cache load loads into cache and returns correct word
-					MEM_WB.LMD = cache_load_32(EX_MEM.ALUOutput);
-				 }
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				break;
-			case 0x21: //LH
-				 if(1 == cache_isHit(EX_MEM.ALUOutput)) {
-					MEM_WB.LMD = cache_read_32(EX_MEM.ALUOutput);
-				 }
-				 else { // Miss -- cache load loads into cache and returns correct word
-					MEM_WB.LMD = cache_load_32(EX_MEM.ALUOutput);
-				 }
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				break;
-			case 0x23: //LW
-				 if(1 == cache_isHit(EX_MEM.ALUOutput)) {
-					MEM_WB.LMD = cache_read_32(EX_MEM.ALUOutput);
-				 }
-				 else { // Miss -- cache load loads into cache and returns correct word
-					MEM_WB.LMD = cache_load_32(EX_MEM.ALUOutput);
-				 }
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x28: //SB
-				if(1 == cache_isHit(EX_MEM.ALUOutput)) {
-					// Modify the word in the cache block 
-					// Then put the block in write-buffer
-					// Flush write-buffer to main memory
-					// Clear write-buffer
-				}
-				else {  // Cache miss
-					// Read whole cache block from main memory
-					// Modify the word in the cache block 
-					// Then put the block in write-buffer
-					// Flush write-buffer to main memory
-					// Clear write-buffer
-				}
-				data = mem_read_32( EX_MEM.ALUOutput);
-				data = (data & 0xFFFFFF00) | (EX_MEM.B & 0x000000FF);
-				mem_write_32(EX_MEM.ALUOutput, data);
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//MEM_WB.RegisterRd = 0;
-				//print_instruction(CURRENT_STATE.PC);				
-				break;
-			case 0x29: //SH
-				data = mem_read_32( EX_MEM.ALUOutput);
-				data = (data & 0xFFFF0000) | (EX_MEM.B & 0x0000FFFF);
-				mem_write_32(EX_MEM.ALUOutput, data);
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//MEM_WB.RegisterRd = 0;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			case 0x2B: //SW
-				if(0 == cache_isHit(EX_MEM.ALUOutput)) { // Cache miss
-					// Read whole cache block into main memory
-					uint32_t dummy = cache_load_32(EX_MEM.ALUOutput);
+	for (i = 0; i < 2; i++){
+		if (!older[i]->valid){
+			continue;
+		}
+		if (older[i]->cls == SS_SYSCALL){
+			*cause = PERF_NO_CAUSE;
+			return TRUE;
+		}
+		for (j = 0; j < 2; j++){
+			for (k = 0; k < 2; k++){
+				if (s->src[j] == 0 || s->src[j] != older[i]->dest[k]){
+					continue;
 				}
-				// Modify the word in the cache block 
-				cache_write_32(EX_MEM.ALUOutput, EX_MEM.B);
-				// Then put the block in write-buffer
-				uint32_t index = (EX_MEM.ALUOutput & 0x000000F0) >> 4; // Block number
-				int i=0;
-				for(i=0; i<WORD_PER_BLOCK; i++) {
-					write_buffer[i] = L1Cache.blocks[index].words[i];
+				if (!ENABLE_FORWARDING){
+					*cause = PERF_RAW_STALL;
+					return TRUE;
 				}
-				// Write write-buffer to main-memory
-				for(i=0; i<WORD_PER_BLOCK; i++) {
-					uint32_t addr_tmp = (EX_MEM.ALUOutput & 0xFFFFFFF0);
-					mem_write_32(addr_tmp+(i*4), write_buffer[i]);
+				if (i == 0 && older[i]->cls == SS_LOAD){
+					*cause = PERF_LOAD_USE;
+					return TRUE;
 				}
-				MEM_WB.RegWrite = EX_MEM.RegWrite;
-				//MEM_WB.RegisterRd = 0;
-				//print_instruction(CURRENT_STATE.PC);
-				break;
-			default:
-				// put more things here
-				printf("MEM at 0x%x is not implemented!\n", CURRENT_STATE.PC);
-				break;
+			}
 		}
 	}
+	return FALSE;
 }
 
 /************************************************************/
-/* execution (EX) pipeline stage:                                                                          */ 
+/* Value of register r as the instruction entering EX sees  */
+/* it: forwarded from EX/MEM, then MEM/WB, when forwarding  */
+/* is on, else the register file. Without forwarding the    */
+/* hazard check kept it in ID until its producers retired   */
 /************************************************************/
-void EX()
+static inline __attribute__((always_inline)) uint32_t pipeline_operand(uint8_t r, const int ENABLE_FORWARDING)
 {
-	/*IMPLEMENT THIS*/
-	while(1){
-		if (EX_MEM.RegWrite == 1 && (EX_MEM.RegisterRd != 0) && (EX_MEM.RegisterRd == IF_EX.RegisterRs)){
-			if(ENABLE_FORWARDING == 0){
-				//printf("EX_MEM.RegWrite: %d EX_MEM.RegisterRd: %d IF_EX.RegisterRs:%d\n", EX_MEM.RegWrite, EX_MEM.RegisterRd, IF_EX.RegisterRs);
-				IF_EX.FLAG = FALSE;
-				EX_MEM.FLAG = FALSE;
-				//printf("flag\n");
-				EX_MEM.IR = 0x00000001;
-				//EX_MEM.RegisterRd = 0;
-				//printf("%u\n", EX_MEM.IR);
-				//printf("EX_MEM.RegWrite: %d EX_MEM.RegisterRd: %d IF_EX.RegisterRs:%d\n", EX_MEM.RegWrite, EX_MEM.RegisterRd, IF_EX.RegisterRs);
-			}
-			else{
-				//printf("EX_MEM.RegWrite: %d EX_MEM.RegisterRd: %d IF_EX.RegisterRs:%d\n", EX_MEM.RegWrite, EX_MEM.RegisterRd, IF_EX.RegisterRs);
-				ForwardA = 10;
-				EX_MEM.FLAG = FALSE;
-				MEM_WB.FLAG = FALSE;
-				//EX_MEM.RegisterRd = 0;
-				//printf("flag5\n");
-				INSTRUCTION_COUNT--;
-				EX_MEM.forward = 1;
-			}
-		}
-		//else{
-		//printf("nothing\n");
-		//}
-		if (EX_MEM.RegWrite == 1 && (EX_MEM.RegisterRd != 0) && (EX_MEM.RegisterRd == IF_EX.RegisterRt)){
-			if(ENABLE_FORWARDING == 0){
-				//printf("EX_MEM.RegWrite: %d EX_MEM.RegisterRd: %d IF_EX.RegisterRt:%d\n", EX_MEM.RegWrite, EX_MEM.RegisterRd, IF_EX.RegisterRt);
-				IF_EX.FLAG = FALSE;
-				EX_MEM.FLAG = FALSE;
-				//printf("flag2\n");
-				EX_MEM.IR = 0x00000001;
-				//EX_MEM.RegisterRd = 0;
-				//printf("%u\n", EX_MEM.IR);
-			}
-			else{
-				//printf("EX_MEM.RegWrite: %d EX_MEM.RegisterRd: %d IF_EX.RegisterRt:%d\n", EX_MEM.RegWrite, EX_MEM.RegisterRd, IF_EX.RegisterRt);
-				ForwardB = 10;
-				EX_MEM.FLAG = FALSE;
-				MEM_WB.FLAG = FALSE;
-				//EX_MEM.RegisterRd = 0;
-				//printf("flag6\n");
-				if (EX_MEM.forward == 0){
-					INSTRUCTION_COUNT--;
+	const SS_Slot *fwd[2] = { &CURRENT_PIPE.EX_MEM, &CURRENT_PIPE.MEM_WB }; // youngest first
+	int i, k;
+
+	if (r == 0){
+		return 0;
+	}
+	if (ENABLE_FORWARDING){
+		for (i = 0; i < 2; i++){
+			for (k = 0; k < 2; k++){
+				if (fwd[i]->valid && fwd[i]->dest[k] == r){
+					return fwd[i]->result[k];
 				}
 			}
 		}
-		//else{
-		//printf("nothing2\n");
-		//}
-		EX_MEM.forward = 0;
-		EX_MEM.RegisterRd = 0;
-		break;
-	}
-
-	if (EX_MEM.FLAG == TRUE && (FALSE == is_branch_jump) && branch_not_taken == FALSE){
-		EX_MEM.IR = IF_EX.IR;
-		//printf("EX_MEM.IR: %u\n", EX_MEM.IR);
-	}
-    if (branch_not_taken == TRUE){
-        EX_MEM.IR = 0x00000000;
-    }
-
-	uint32_t opcode, function, rt, rd;
-	uint64_t p1, p2;
-
-	opcode = (EX_MEM.IR & 0xFC000000) >> 26;
-	function = EX_MEM.IR & 0x0000003F;
-	rt = (IF_EX.IR & 0x001F0000) >> 16;
-	rd = (IF_EX.IR & 0x0000F800) >> 11;
-
-	if(EX_MEM.FLAG == TRUE && (FALSE == is_branch_jump) && branch_not_taken == FALSE){
-		if(opcode == 0x00 && EX_MEM.IR != 0){
-			switch(function){
-				case 0x00: //SLL
-					EX_MEM.ALUOutput = IF_EX.A << IF_EX.imm;
-					EX_MEM.RegisterRd = rd;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x02: //SRL
-					EX_MEM.ALUOutput = IF_EX.A >> IF_EX.imm;
-					EX_MEM.RegisterRd = rd;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x03: //SRA 
-					if ((IF_EX.A & 0x80000000) == 1){
-						EX_MEM.ALUOutput = ~(~IF_EX.A >> IF_EX.imm);
-					}
-					else{
-						EX_MEM.ALUOutput = IF_EX.A >> IF_EX.imm;
-					}
-					EX_MEM.RegisterRd = rd;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-                case 0x08: //JR
-				    NEXT_STATE.PC = IF_EX.A;
-				    is_branch_jump = TRUE;
-				    //print_instruction(CURRENT_STATE.PC);
-				    break;
-                case 0x09: //JALR
-                    EX_MEM.ALUOutput = CURRENT_STATE.PC - 8;
-				    NEXT_STATE.PC = IF_EX.A;
-				    is_branch_jump = TRUE;
-				case 0x0C: //SYSCALL
-					EX_MEM.ALUOutput = IF_EX.A;
-                    EX_MEM.RegisterRd = rd;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x10: //MFHI
-					EX_MEM.ALUOutput = IF_EX.A;
-                    NEXT_STATE.REGS[rd] = EX_MEM.ALUOutput;
-					EX_MEM.RegisterRd = rd;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x11: //MTHI
-					EX_MEM.ALUOutput = IF_EX.A;
-                    EX_MEM.HI = 1;
-                    EX_MEM.RegisterRd = 33;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x12: //MFLO
-					EX_MEM.ALUOutput = IF_EX.A;
-                    NEXT_STATE.REGS[rd] = EX_MEM.ALUOutput;
-					EX_MEM.RegisterRd = rd;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x13: //MTLO
-					EX_MEM.ALUOutput = IF_EX.A;
-                    NEXT_STATE.LO = EX_MEM.ALUOutput;
-                    EX_MEM.LO = 1;
-                    EX_MEM.RegisterRd = 33;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x18: //MULT
-					if ((IF_EX.A & 0x80000000) == 0x80000000){
-						p1 = 0xFFFFFFFF00000000 | IF_EX.A;
-					}else{
-						p1 = 0x00000000FFFFFFFF & IF_EX.A;
-					}
-					if ((IF_EX.B & 0x80000000) == 0x80000000){
-						p2 = 0xFFFFFFFF00000000 | IF_EX.B;
-					}else{
-						p2 = 0x00000000FFFFFFFF & IF_EX.B;
-					}
-					EX_MEM.AA = p1 * p2;
-                    EX_MEM.HI = 2;
-                    EX_MEM.LO = 2;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x19: //MULTU
-					EX_MEM.AA = IF_EX.A * IF_EX.B;
-                    EX_MEM.HI = 2;
-                    EX_MEM.LO = 2;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x1A: //DIV 
-					if (IF_EX.B != 0){
-						EX_MEM.ALUOutput = IF_EX.A / IF_EX.B;
-						EX_MEM.A = IF_EX.A % IF_EX.B;
-					}
-                    EX_MEM.HI = 3;
-                    EX_MEM.LO = 3;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x1B: //DIVU
-					if (IF_EX.B != 0){
-						EX_MEM.ALUOutput = IF_EX.A / IF_EX.B;
-						EX_MEM.A = IF_EX.A % IF_EX.B;
-					}
-                    EX_MEM.HI = 3;
-                    EX_MEM.LO = 3;
-                    EX_MEM.RegisterRd = 33;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x20: //ADD
-					EX_MEM.ALUOutput = IF_EX.A + IF_EX.B;
-					EX_MEM.RegisterRd = rd;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x21: //ADDU 
-					EX_MEM.ALUOutput = IF_EX.A + IF_EX.B;
-					EX_MEM.RegisterRd = rd;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x22: //SUB
-					EX_MEM.ALUOutput = IF_EX.A - IF_EX.B;
-					EX_MEM.RegisterRd = rd;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x23: //SUBU
-					EX_MEM.ALUOutput = IF_EX.A - IF_EX.B;
-					EX_MEM.RegisterRd = rd;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x24: //AND
-					EX_MEM.ALUOutput = IF_EX.A & IF_EX.B;
-					EX_MEM.RegisterRd = rd;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x25: //OR
-					EX_MEM.ALUOutput = IF_EX.A | IF_EX.B;
-                    //printf("or: %u\n", EX_MEM.ALUOutput);
-					EX_MEM.RegisterRd = rd;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x26: //XOR
-					EX_MEM.ALUOutput = IF_EX.A ^ IF_EX.B;
-                    NEXT_STATE.REGS[rd] = EX_MEM.ALUOutput;
-					EX_MEM.RegisterRd = rd;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x27: //NOR
-					EX_MEM.ALUOutput = ~(IF_EX.A | IF_EX.B);
-					EX_MEM.RegisterRd = rd;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x2A: //SLT
-					if(IF_EX.A < IF_EX.B){
-						EX_MEM.ALUOutput = 0x1;
-					}
-					else{
-						EX_MEM.ALUOutput = 0x0;
-					}
-                    NEXT_STATE.REGS[rd] = EX_MEM.ALUOutput;
-					EX_MEM.RegisterRd = rd;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				default:
-					printf("EX at 0x%x is not implemented!\n", CURRENT_STATE.PC);
-					break;
-			}
-		}
-		else{
-			switch(opcode){
-                case 0x01:
-				    if(rt == 0x00000){ //BLTZ
-					   if((IF_EX.A & 0x80000000) > 0){
-						  NEXT_STATE.PC = (CURRENT_STATE.PC - 8) + ( (IF_EX.imm & 0x8000) > 0 ? (IF_EX.imm | 0xFFFF0000)<<2 : (IF_EX.imm & 0x0000FFFF)<<2);
-						  is_branch_jump = TRUE;
-					   }
-                        is_branch_jump = TRUE;
-					   //print_instruction(CURRENT_STATE.PC);
-				    }
-				    else if(rt == 0x00001){ //BGEZ
-					   if((IF_EX.A & 0x80000000) == 0x0){
-						  NEXT_STATE.PC = (CURRENT_STATE.PC - 8) + ( (IF_EX.imm & 0x8000) > 0 ? (IF_EX.imm | 0xFFFF0000)<<2 : (IF_EX.imm & 0x0000FFFF)<<2);
-						  is_branch_jump = TRUE;
-					   }
-                        is_branch_jump = TRUE;
-					   //print_instruction(CURRENT_STATE.PC);
-				    }
-				    break;
-				case 0x02: // J
-					NEXT_STATE.PC = ((CURRENT_STATE.PC ) & 0xF0000000) | (IF_EX.imm << 2);
-					is_branch_jump = TRUE; // Unset so IF fetches correct instr
-					break;
-                case 0x03: //JAL
-				    NEXT_STATE.PC = ((CURRENT_STATE.PC ) & 0xF0000000) | (IF_EX.imm << 2);
-				    EX_MEM.ALUOutput = CURRENT_STATE.PC - 8;
-				    is_branch_jump = TRUE;
-				    //print_instruction(CURRENT_STATE.PC);
-				    break;
-                case 0x04: //BEQ
-				    if(IF_EX.A == IF_EX.B){
-					   NEXT_STATE.PC = (CURRENT_STATE.PC - 8) + ( (IF_EX.imm & 0x8000) > 0 ? (IF_EX.imm | 0xFFFF0000)<<2 : (IF_EX.imm & 0x0000FFFF)<<2);
-					   is_branch_jump = TRUE;
-				    }
-                        is_branch_jump = TRUE;
-				    //print_instruction(CURRENT_STATE.PC);
-				    break;
-                case 0x05: //BNE
-				    if(IF_EX.A != IF_EX.B){
-                        NEXT_STATE.PC = (CURRENT_STATE.PC - 8) + ( (IF_EX.imm & 0x8000) > 0 ? (IF_EX.imm | 0xFFFF0000)<<2 : (IF_EX.imm & 0x0000FFFF)<<2);
-                        is_branch_jump = TRUE;
-				    }
-                        is_branch_jump = TRUE;
-				    //print_instruction(CURRENT_STATE.PC);
-				    break;
-                case 0x06: //BLEZ
-				    if((IF_EX.A & 0x80000000) > 0 || IF_EX.A == 0){
-                        NEXT_STATE.PC = (CURRENT_STATE.PC - 8) +  ( (IF_EX.imm & 0x8000) > 0 ? (IF_EX.imm | 0xFFFF0000)<<2 : (IF_EX.imm & 0x0000FFFF)<<2);
-                        is_branch_jump = TRUE;
-				    }
-                        is_branch_jump = TRUE;
-				    //print_instruction(CURRENT_STATE.PC);
-				    break;
-                case 0x07: //BGTZ
-				    if((IF_EX.A & 0x80000000) == 0x0 || IF_EX.A != 0){
-                        NEXT_STATE.PC = (CURRENT_STATE.PC - 8) +  ( (IF_EX.imm & 0x8000) > 0 ? (IF_EX.imm | 0xFFFF0000)<<2 : (IF_EX.imm & 0x0000FFFF)<<2);
-                        is_branch_jump = TRUE;
-				    }
-                        is_branch_jump = TRUE;
-				    //print_instruction(CURRENT_STATE.PC);
-				    break;
-				case 0x08: //ADDI
-					EX_MEM.ALUOutput = IF_EX.A + ( (IF_EX.imm & 0x8000) > 0 ? (IF_EX.imm | 0xFFFF0000) : (IF_EX.imm & 0x0000FFFF));
-					EX_MEM.RegisterRd = rt;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x09: //ADDIU
-					EX_MEM.ALUOutput = IF_EX.A + ( (IF_EX.imm & 0x8000) > 0 ? (IF_EX.imm | 0xFFFF0000) : (IF_EX.imm & 0x0000FFFF));
-					EX_MEM.RegisterRd = rt;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x0A: //SLTI
-					if ( (  IF_EX.A - (int32_t)( (IF_EX.imm & 0x8000) > 0 ? (IF_EX.imm | 0xFFFF0000) : (IF_EX.imm & 0x0000FFFF))) < 0){
-						EX_MEM.ALUOutput = 0x1;
-					}else{
-						EX_MEM.ALUOutput = 0x0;
-					}
-					EX_MEM.RegisterRd = rt;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x0C: //ANDI
-					EX_MEM.ALUOutput = IF_EX.A & (IF_EX.imm & 0x0000FFFF);
-					EX_MEM.RegisterRd = rt;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x0D: //ORI
-					EX_MEM.ALUOutput = IF_EX.A | (IF_EX.imm & 0x0000FFFF);
-					EX_MEM.RegisterRd = rt;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x0E: //XORI
-					EX_MEM.ALUOutput = IF_EX.A ^ (IF_EX.imm & 0x0000FFFF);
-					EX_MEM.RegisterRd = rt;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x0F: //LUI
-					EX_MEM.ALUOutput = IF_EX.imm << 16;
-					EX_MEM.RegisterRd = rt;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x20: //LB
-					EX_MEM.ALUOutput = IF_EX.A + ( (IF_EX.imm & 0x8000) > 0 ? (IF_EX.imm | 0xFFFF0000) : (IF_EX.imm & 0x0000FFFF));
-					EX_MEM.RegisterRd = rt;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x21: //LH
-					EX_MEM.ALUOutput = IF_EX.A + ( (IF_EX.imm & 0x8000) > 0 ? (IF_EX.imm | 0xFFFF0000) : (IF_EX.imm & 0x0000FFFF));
-					EX_MEM.RegisterRd = rt;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x23: //LW
-					EX_MEM.ALUOutput = IF_EX.A + ( (IF_EX.imm & 0x8000) > 0 ? (IF_EX.imm | 0xFFFF0000) : (IF_EX.imm & 0x0000FFFF));
-					EX_MEM.RegisterRd = rt;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x28: //SB
-					EX_MEM.ALUOutput = IF_EX.A + ( (IF_EX.imm & 0x8000) > 0 ? (IF_EX.imm | 0xFFFF0000) : (IF_EX.imm & 0x0000FFFF));
-					EX_MEM.B = IF_EX.B;
-					EX_MEM.RegisterRd = 0;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);				
-					break;
-				case 0x29: //SH
-					EX_MEM.ALUOutput = IF_EX.A + ( (IF_EX.imm & 0x8000) > 0 ? (IF_EX.imm | 0xFFFF0000) : (IF_EX.imm & 0x0000FFFF));
-					EX_MEM.B = IF_EX.B;
-					EX_MEM.RegisterRd = 0;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x2B: //SW
-					EX_MEM.ALUOutput = IF_EX.A + ( (IF_EX.imm & 0x8000) > 0 ? (IF_EX.imm | 0xFFFF0000) : (IF_EX.imm & 0x0000FFFF));
-					EX_MEM.B = IF_EX.B;
-					EX_MEM.RegisterRd = 0;
-					EX_MEM.RegWrite = IF_EX.RegWrite;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				default:
-					// put more things here
-					printf("EX at 0x%x is not implemented!\n", CURRENT_STATE.PC);
-					break;
-			}
-		}
-	}
-	if(TRUE == branch_taken) { // Flush
-		EX_MEM.IR = 0;
-		EX_MEM.A = 0;
-		EX_MEM.B = 0;
-		EX_MEM.AA = 0;
-		EX_MEM.BB = 0;
-		EX_MEM.RegisterRs = 0;
-		EX_MEM.RegisterRt = 0;
-		EX_MEM.RegisterRd = 0;
-		EX_MEM.imm = 0;
-        //branch_not_taken = FALSE; 
 	}
+	return r == REG_HI ? CURRENT_STATE.HI : r == REG_LO ? CURRENT_STATE.LO : CURRENT_STATE.REGS[r];
 }
 
 /************************************************************/
-/* instruction decode (ID) pipeline stage:                                                         */ 
+/* writeback (WB) pipeline stage: retire MEM/WB into the    */
+/* next architectural state                                 */
 /************************************************************/
-void ID()
+STAGE WB_stage(STAGE_MODES)
 {
-	/*IMPLEMENT THIS*/
-	if (ENABLE_FORWARDING == 1 && IF_EX.MemRead == 1 && ((IF_EX.RegisterRt == ID_IF.RegisterRs) || (IF_EX.RegisterRt == ID_IF.RegisterRt))){
-		IF_EX.IR = 0x00000001;
-		IF_EX.FLAG = FALSE;
-	}
-
-        //printf("IF_EX.FLAG = %d\n", IF_EX.FLAG);
-    //printf("EX_MEM.FLAG = %d\n", EX_MEM.FLAG);
-	if (IF_EX.FLAG == TRUE && EX_MEM.FLAG == TRUE && (FALSE == is_branch_jump)) {
-		IF_EX.IR = ID_IF.IR;
-		//printf("IF_EX.IR: %u\n", IF_EX.IR);
-        branch_not_taken = FALSE;
-	}
-
-	uint32_t opcode, function, rs, rt, sa, immediate, target;
-
-	//printf("[0x%x]\t", CURRENT_STATE.PC);
-
-	opcode = (IF_EX.IR & 0xFC000000) >> 26;
-	function = IF_EX.IR & 0x0000003F;
-	rs = (IF_EX.IR & 0x03E00000) >> 21;
-	rt = (IF_EX.IR & 0x001F0000) >> 16;
-	//rd = (IF_EX.IR & 0x0000F800) >> 11;
-	sa = (IF_EX.IR & 0x000007C0) >> 6;
-	immediate = IF_EX.IR & 0x0000FFFF;
-	target = IF_EX.IR & 0x03FFFFFF;
-
-	if(IF_EX.FLAG == TRUE){
-		if(opcode == 0x00 && IF_EX.IR != 0){
-			switch(function){
-				case 0x00: //SLL
-					if (ForwardB == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.imm = sa;
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegisterRs = 0;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x02: //SRL
-					if (ForwardB == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.imm = sa;
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegisterRs = 0;
-					IF_EX.RegWrite = 1;
-					// print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x03: //SRA 
-					if (ForwardB == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.imm = sa;
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegisterRs = 0;
-					IF_EX.RegWrite = 1;
-					// print_instruction(CURRENT_STATE.PC);
-					break;
-                case 0x08: //JR
-                    IF_EX.A = CURRENT_STATE.REGS[rs];
-				    //print_instruction(CURRENT_STATE.PC);
-				    break;
-                case 0x09: //JALR
-                    IF_EX.A = CURRENT_STATE.REGS[rs];
-				    //print_instruction(CURRENT_STATE.PC);
-				    break;
-				case 0x0C: //SYSCALL
-					IF_EX.A = CURRENT_STATE.REGS[2];
-                    IF_EX.RegisterRs = 0x2;
-                    IF_EX.RegWrite = 1;
-                    //printf("syscall: %u", IF_EX.A);
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x10: //MFHI
-                    if (ForwardB == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.HI;
-					}
-					//IF_EX.A = CURRENT_STATE.HI;
-                    //printf("HI: %u", CURRENT_STATE.HI);
-                    IF_EX.RegisterRs = 33;
-					IF_EX.RegisterRt = 0;
-					IF_EX.RegWrite = 1;
-					// print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x11: //MTHI
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegisterRt = 0;
-					IF_EX.RegWrite = 1;
-					// print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x12: //MFLO
-					IF_EX.A = CURRENT_STATE.LO;
-                    //printf("LO: %u", CURRENT_STATE.LO);
-                    IF_EX.RegisterRs = 33;
-					IF_EX.RegisterRt = 0;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x13: //MTLO
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-                        //printf("flag1: %u", IF_EX.A);
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-                        //printf("flag2: %u", IF_EX.A);
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-                        //printf("flag3: %u", IF_EX.A);
-					}
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegisterRt = 0;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x18: //MULT
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					if (ForwardB == 10){
-						IF_EX.B = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.B = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.B = CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegWrite = 1;
-					// print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x19: //MULTU
-					if (ForwardA == 10){
-						IF_EX.AA = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.AA = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.AA = (int64_t)CURRENT_STATE.REGS[rs];
-					}
-					if (ForwardB == 10){
-						IF_EX.BB = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.BB = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.BB = (int64_t)CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x1A: //DIV 
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = (int32_t)CURRENT_STATE.REGS[rs];
-					}
-					if (ForwardB == 10){
-						IF_EX.B = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.B = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.B = (int32_t)CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x1B: //DIVU
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					if (ForwardB == 10){
-						IF_EX.B = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.B = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.B = CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x20: //ADD
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					if (ForwardB == 10){
-						IF_EX.B = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.B = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.B = CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x21: //ADDU 
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					if (ForwardB == 10){
-						IF_EX.B = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.B = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.B = CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x22: //SUB
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					if (ForwardB == 10){
-						IF_EX.B = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.B = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.B = CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x23: //SUBU
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					if (ForwardB == 10){
-						IF_EX.B = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.B = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.B = CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x24: //AND
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					if (ForwardB == 10){
-						IF_EX.B = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.B = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.B = CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x25: //OR
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-                        //printf("F1\n");
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-                        //printf("F2\n");
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-                        //printf("RS: %u\n", CURRENT_STATE.REGS[rs]);
-                        //printf("F3");
-					}
-					if (ForwardB == 10){
-						IF_EX.B = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.B = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.B = CURRENT_STATE.REGS[rt];
-					}
-                    //printf("RS: %u\n", IF_EX.A);
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegisterRs = rs;
-                    //printf("$RS: %u\n", IF_EX.RegisterRs);
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x26: //XOR
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					if (ForwardB == 10){
-						IF_EX.B = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.B = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.B = CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x27: //NOR
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					if (ForwardB == 10){
-						IF_EX.B = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.B = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.B = CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x2A: //SLT
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					if (ForwardB == 10){
-						IF_EX.B = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.B = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.B = CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				default:
-					printf("ID at 0x%x is not implemented!\n", CURRENT_STATE.PC);
-					break;
-			}
-		}
-		else{
-			switch(opcode){
-				case 0x01:
-                    IF_EX.A = CURRENT_STATE.REGS[rs];
-                    IF_EX.imm = immediate; 
-				    break;
-				case 0x02: // J
-					IF_EX.imm = target; 
-					break;
-                case 0x03: //JAL
-                    IF_EX.imm = target; 
-				    //print_instruction(CURRENT_STATE.PC);
-				    break;
-                case 0x04: //BEQ
-				    IF_EX.A = CURRENT_STATE.REGS[rs];
-                    IF_EX.B = CURRENT_STATE.REGS[rt];
-                    IF_EX.imm = immediate; 
-				    //print_instruction(CURRENT_STATE.PC);
-				    break;
-                case 0x05: //BNE
-				    IF_EX.A = CURRENT_STATE.REGS[rs];
-                    IF_EX.B = CURRENT_STATE.REGS[rt];
-                    IF_EX.imm = immediate; 
-				    //print_instruction(CURRENT_STATE.PC);
-				    break;
-                case 0x06: //BLEZ
-				    IF_EX.A = CURRENT_STATE.REGS[rs];
-                    IF_EX.imm = immediate; 
-				    //print_instruction(CURRENT_STATE.PC);
-				    break;
-                case 0x07: //BGTZ
-                    IF_EX.A = CURRENT_STATE.REGS[rs];
-                    IF_EX.imm = immediate; 
-				    //print_instruction(CURRENT_STATE.PC);
-				    break;
-				case 0x08: //ADDI
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					IF_EX.imm = immediate;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegisterRt = 0;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x09: //ADDIU
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					IF_EX.imm = immediate;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegisterRt = 0;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x0A: //SLTI
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = (int32_t)CURRENT_STATE.REGS[rs];
-					}
-					IF_EX.imm = immediate;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegisterRt = 0;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x0C: //ANDI
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					IF_EX.imm = immediate;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegisterRt = 0;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x0D: //ORI
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					IF_EX.imm = immediate;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegisterRt = 0;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x0E: //XORI
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					IF_EX.imm = immediate;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegisterRt = 0;
-					IF_EX.RegWrite = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x0F: //LUI
-					IF_EX.imm = immediate;
-					IF_EX.RegWrite = 1;
-					IF_EX.RegisterRs = 0;
-					IF_EX.RegisterRt = 0;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x20: //LB
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					IF_EX.imm = immediate;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegWrite = 1;
-					IF_EX.MemRead = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x21: //LH
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					IF_EX.imm = immediate;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegWrite = 1;
-					IF_EX.MemRead = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x23: //LW
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					IF_EX.imm = immediate;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegWrite = 1;
-					IF_EX.MemRead = 1;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x28: //SB
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					if (ForwardB == 10){
-						IF_EX.B = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.B = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.B = CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.imm = immediate;	
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegWrite = 0;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x29: //SH
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					if (ForwardB == 10){
-						IF_EX.B = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.B = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.B = CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.imm = immediate;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegWrite = 0;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				case 0x2B: //SW
-					if (ForwardA == 10){
-						IF_EX.A = EX_MEM.ALUOutput;
-					}
-					else if (ForwardA == 01){
-						IF_EX.A = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.A = CURRENT_STATE.REGS[rs];
-					}
-					if (ForwardB == 10){
-						IF_EX.B = EX_MEM.ALUOutput;
-					}
-					else if (ForwardB == 01){
-						IF_EX.B = MEM_WB.ALUOutput;
-					}
-					else{
-						IF_EX.B = CURRENT_STATE.REGS[rt];
-					}
-					IF_EX.imm = immediate;
-					IF_EX.RegisterRs = rs;
-					IF_EX.RegisterRt = rt;
-					IF_EX.RegWrite = 0;
-					//print_instruction(CURRENT_STATE.PC);
-					break;
-				default:
-					// put more things here
-					printf("ID at 0x%x is not implemented!\n", CURRENT_STATE.PC);
-					break;
-			}
+	SS_Slot s = CURRENT_PIPE.MEM_WB;
+
+	if (!s.valid){
+		profile_retire(0, 0);
+		return;
+	}
+	ss_write_regs(&s, &NEXT_STATE);
+	TRACE_INSTRUCTION(s.pc);
+	perf_retire(s.ir);
+	profile_retire(s.ir, s.pc);
+	INSTRUCTION_COUNT++;
+	if (s.cls == SS_SYSCALL){
+		syscall_exec(s.result[0], CURRENT_STATE.REGS[4], &NEXT_STATE.REGS[2]);
+	}
+}
+
+/************************************************************/
+/* memory access (MEM) pipeline stage: EX/MEM to MEM/WB     */
+/************************************************************/
+STAGE MEM_stage(STAGE_MODES)
+{
+	SS_Slot *s = &NEXT_PIPE.MEM_WB;
+
+	*s = CURRENT_PIPE.EX_MEM;
+	if (s->valid && (s->cls == SS_LOAD || s->cls == SS_STORE)){
+		mem_access_hooks(s->ir, s->pc, s->addr, ss_access(s), MEM_MODELS);
+	}
+}
+
+/************************************************************/
+/* execution (EX) pipeline stage: ID/EX to EX/MEM. A taken  */
+/* branch raises redirect for the next cycle, which steers  */
+/* the PC and squashes the two instructions behind it       */
+/************************************************************/
+STAGE EX_stage(STAGE_MODES)
+{
+	SS_Slot *s = &NEXT_PIPE.EX_MEM;
+	uint32_t target;
+
+	*s = CURRENT_PIPE.ID_EX;
+	NEXT_PIPE.redirect = FALSE;
+	if (!s->valid){
+		return;
+	}
+	if (CURRENT_PIPE.redirect){
+		s->valid = FALSE;
+		PERF_INC(PERF_CONTROL_FLUSH);
+		return;
+	}
+	fu_issue(s->ir);
+	if (ss_evaluate(s, pipeline_operand(s->src[0], ENABLE_FORWARDING), pipeline_operand(s->src[1], ENABLE_FORWARDING), &target)){
+		NEXT_PIPE.redirect = TRUE;
+		NEXT_PIPE.target = target;
+	}
+}
+
+/************************************************************/
+/* instruction decode (ID) pipeline stage: IF/ID to ID/EX,  */
+/* or a bubble while pipeline_hazard() holds it             */
+/************************************************************/
+STAGE ID_stage(STAGE_MODES)
+{
+	perf_counter_t cause;
+
+	NEXT_PIPE.ID_EX = CURRENT_PIPE.IF_ID;
+	if (!CURRENT_PIPE.IF_ID.valid){
+		return;
+	}
+	if (CURRENT_PIPE.redirect){
+		NEXT_PIPE.ID_EX.valid = FALSE;
+		PERF_INC(PERF_CONTROL_FLUSH);
+	}
+	else if (pipeline_hazard(ENABLE_FORWARDING, &cause)){
+		NEXT_PIPE.ID_EX.valid = FALSE;
+		if (cause != PERF_NO_CAUSE){
+			PERF_INC(cause);
 		}
 	}
-    //printf("branch_taken: %d\n", branch_taken);
-    //printf("is_branch_jump: %d\n", is_branch_jump);
-    
-	if(TRUE == branch_taken) { // Flush
-		IF_EX.IR = 0;
-		IF_EX.A = 0;
-		IF_EX.B = 0;
-		IF_EX.AA = 0;
-		IF_EX.BB = 0;
-		IF_EX.RegisterRs = 0;
-		IF_EX.RegisterRt = 0;
-		IF_EX.imm = 0;
+}
+
+/************************************************************/
+/* instruction fetch (IF) pipeline stage: fetch and decode  */
+/* into IF/ID, or keep IF/ID and the PC while ID is stalled */
+/************************************************************/
+STAGE IF_stage(STAGE_MODES)
+{
+	perf_counter_t cause;
+
+	if (pipeline_hazard(ENABLE_FORWARDING, &cause)){
+		NEXT_PIPE.IF_ID = CURRENT_PIPE.IF_ID;
+		NEXT_STATE.PC = CURRENT_STATE.PC;
+		return;
+	}
+	if (MEM_MODELS && REUSE_ENABLED){
+		reuse_access(REUSE_INST, CURRENT_STATE.PC);
 	}
+	ss_decode(&NEXT_PIPE.IF_ID, mem_read_32(CURRENT_STATE.PC), CURRENT_STATE.PC);
+	NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
 
 /************************************************************/
-/* instruction fetch (IF) pipeline stage:                                                              */ 
+/* Pipeline variants, one per combination of modes. Each    */
+/* stage reads only CURRENT_PIPE and writes its own latch   */
+/* in NEXT_PIPE, so the order below is arbitrary            */
+/************************************************************/
+#define PIPELINE_VARIANT(fwd, trace, mem) \
+	void pipeline_f##fwd##_t##trace##_m##mem() { \
+		if (core_frozen(mem, FALSE)) { \
+			return; \
+		} \
+		WB_stage(fwd, trace, mem); \
+		MEM_stage(fwd, trace, mem); \
+		EX_stage(fwd, trace, mem); \
+		ID_stage(fwd, trace, mem); \
+		IF_stage(fwd, trace, mem); \
+		pipeline_latch(); \
+	}
+
+PIPELINE_VARIANT(0, 0, 0)
+PIPELINE_VARIANT(0, 0, 1)
+PIPELINE_VARIANT(0, 1, 0)
+PIPELINE_VARIANT(0, 1, 1)
+PIPELINE_VARIANT(1, 0, 0)
+PIPELINE_VARIANT(1, 0, 1)
+PIPELINE_VARIANT(1, 1, 0)
+PIPELINE_VARIANT(1, 1, 1)
+
+void (*const PIPELINE_VARIANTS[2][2][2])() = { // [forwarding][trace][memory models]
+	{ { pipeline_f0_t0_m0, pipeline_f0_t0_m1 }, { pipeline_f0_t1_m0, pipeline_f0_t1_m1 } },
+	{ { pipeline_f1_t0_m0, pipeline_f1_t0_m1 }, { pipeline_f1_t1_m0, pipeline_f1_t1_m1 } },
+};
+
+/* The superscalar and out-of-order backends; loads that miss wait in the ROB, not in front of the pipeline */
+void pipeline_wide_m0() { if (!core_frozen(FALSE, TRUE)) ss_pipeline(); }
+void pipeline_wide_m1() { if (!core_frozen(TRUE, TRUE)) ss_pipeline(); }
+void pipeline_ooo_m0() { ooo_cycle(); }
+void pipeline_ooo_m1() { if (!mem_frozen()) ooo_cycle(); }
+
+/* TRUE when a miss can freeze the core, or any model after the L1 needs to see data accesses */
+int mem_models_active() {
+	return CACHE_MISS_PENALTY > 0 || NUM_CORES > 1 || PREFETCHER != PREFETCH_NONE || DRAM_ENABLED || MSHR_COUNT || REUSE_ENABLED;
+}
+
+/* Stages that read the modes on every call, for callers that run them one at a time */
+void WB() { WB_stage(ENABLE_FORWARDING, TRACE_LEVEL, mem_models_active()); }
+void MEM() { MEM_stage(ENABLE_FORWARDING, TRACE_LEVEL, mem_models_active()); }
+void EX() { EX_stage(ENABLE_FORWARDING, TRACE_LEVEL, mem_models_active()); }
+void ID() { ID_stage(ENABLE_FORWARDING, TRACE_LEVEL, mem_models_active()); }
+void IF() { IF_stage(ENABLE_FORWARDING, TRACE_LEVEL, mem_models_active()); }
+
+void (*PIPELINE)() = handle_pipeline;
+
+/************************************************************/
+/* maintain the pipeline: the scalar cycle, reading the     */
+/* modes on every call; with HOST_STAGE_SAMPLE, every Nth   */
+/* cycle times its stages                                   */
 /************************************************************/
-void IF()
+void handle_pipeline()
 {
-	if (IF_EX.FLAG == TRUE && EX_MEM.FLAG == TRUE && (FALSE == is_branch_jump) ){ // Execute as normal
-		ID_IF.IR = mem_read_32(CURRENT_STATE.PC);
-		ID_IF.PC = CURRENT_STATE.PC + 4;
-		NEXT_STATE.PC = ID_IF.PC;
-	}
-	//   else{
-	//  print_instruction(CURRENT_STATE.PC);
-	//}
-	if (ID_IF.IR == 0){
-		printf("NO INSTRUCTIONS FOR IF.\n");
-	}
-	//else{
-	//print_instruction(CURRENT_STATE.PC);
-	//}
-	if (IF_EX.FLAG == TRUE && EX_MEM.FLAG == FALSE){
-		EX_MEM.FLAG = TRUE;
-		ForwardA = 00;
-		ForwardB = 00;
-	}
-	if (IF_EX.FLAG == FALSE && EX_MEM.FLAG == TRUE){
-		IF_EX.MemRead = 0;
-	}
-    if (branch_taken == TRUE){
-        ID_IF.IR = 0;
-    }
-	//show_pipeline();
+	if (core_frozen(mem_models_active(), FALSE)){
+		return;
+	}
+	if (HOST_STAGE_SAMPLE && (CYCLE_COUNT % HOST_STAGE_SAMPLE) == 0){
+		host_sampled_pipeline();
+	}
+	else {
+		WB();
+		MEM();
+		EX();
+		ID();
+		IF();
+	}
+	pipeline_latch();
+}
+
+/***************************************************************/
+/* Pick the backend and variant for the current modes; called  */
+/* once at the start of run()/runAll(), so parameters changed  */
+/* between runs take effect on the next one                    */
+/***************************************************************/
+void pipeline_select() {
+	int mem = mem_models_active();
+
+	if (OOO_ENABLED) {
+		PIPELINE = mem ? pipeline_ooo_m1 : pipeline_ooo_m0;
+	}
+	else if (ISSUE_WIDTH > 1) {
+		PIPELINE = mem ? pipeline_wide_m1 : pipeline_wide_m0;
+	}
+	else if (HOST_STAGE_SAMPLE) {
+		PIPELINE = handle_pipeline;
+	}
+	else {
+		PIPELINE = PIPELINE_VARIANTS[ENABLE_FORWARDING != 0][TRACE_LEVEL != 0][mem];
+	}
+}
+
+
+/***************************************************************/
+/* Empty the scalar pipeline: the next IF fetches at PC        */
+/***************************************************************/
+void pipeline_clear() {
+	memset(&CURRENT_PIPE, 0, sizeof(CURRENT_PIPE));
+	memset(&NEXT_PIPE, 0, sizeof(NEXT_PIPE));
+}
+
+/***************************************************************/
+/* Clock edge of the scalar pipeline, once per cycle: the      */
+/* latches and architectural state take what the stages wrote, */
+/* and a redirect raised in EX steers the PC to its target     */
+/***************************************************************/
+void pipeline_latch() {
+	if (NEXT_PIPE.redirect) {
+		NEXT_STATE.PC = NEXT_PIPE.target;
+	}
+	CURRENT_PIPE = NEXT_PIPE;
+	CURRENT_STATE = NEXT_STATE;
+}
+
+/* Instruction in the scalar EX stage this cycle; 0 for a bubble or one being squashed */
+uint32_t pipeline_ex_ir() {
+	return CURRENT_PIPE.ID_EX.valid && !CURRENT_PIPE.redirect ? CURRENT_PIPE.ID_EX.ir : 0;
 }
 
+/* PC of the oldest instruction in the scalar pipeline, all of which are unretired; pc when it is empty */
+uint32_t pipeline_oldest_pc(uint32_t pc) {
+	if (CURRENT_PIPE.MEM_WB.valid) {
+		return CURRENT_PIPE.MEM_WB.pc;
+	}
+	if (CURRENT_PIPE.EX_MEM.valid) {
+		return CURRENT_PIPE.EX_MEM.pc;
+	}
+	if (CURRENT_PIPE.redirect) { // ID/EX and IF/ID are wrong-path, pc is already the target
+		return pc;
+	}
+	if (CURRENT_PIPE.ID_EX.valid) {
+		return CURRENT_PIPE.ID_EX.pc;
+	}
+	return CURRENT_PIPE.IF_ID.valid ? CURRENT_PIPE.IF_ID.pc : pc;
+}
+
+/***************************************************************/
+/* Called before a parameter that selects or resets a backend  */
+/* changes mid-run: squash everything in flight on every core   */
+/* and point the PC back at the oldest instruction not yet      */
+/* retired, so the next backend fetches it again                */
+/***************************************************************/
+void pipeline_flush() {
+	int c, cur = CURRENT_CORE;
+
+	for (c = 0; c < NUM_CORES; c++) {
+		core_switch(c);
+		if (OOO_ENABLED) {
+			CURRENT_STATE.PC = ooo_oldest_pc(&OOO_STATE[c], CURRENT_STATE.PC);
+		}
+		else if (ISSUE_WIDTH > 1) {
+			CURRENT_STATE.PC = ss_oldest_pc(&SS_STATE[c], CURRENT_STATE.PC);
+		}
+		else {
+			CURRENT_STATE.PC = pipeline_oldest_pc(CURRENT_STATE.PC);
+		}
+		NEXT_STATE = CURRENT_STATE;
+		ooo_reset_core(&OOO_STATE[c]);
+		memset(&SS_STATE[c], 0, sizeof(SS_STATE[c]));
+		pipeline_clear();
+	}
+	core_switch(cur);
+}
 
 /************************************************************/
 /* Initialize Memory                                                                                                    */ 
@@ -2318,22 +1150,13 @@ void initialize() {
 	CURRENT_STATE.PC = MEM_TEXT_BEGIN;
 	NEXT_STATE = CURRENT_STATE;
 	RUN_FLAG = TRUE;
-	EX_MEM.RegWrite = 1;
-	MEM_WB.RegWrite = 1;
-	IF_EX.MemRead = 0;
-	EX_MEM.FLAG = TRUE;
-	MEM_WB.FLAG = TRUE;
-	IF_EX.FLAG = TRUE;
+	pipeline_clear();
 	ENABLE_FORWARDING = 0;
-	ForwardA = 0;
-	ForwardB = 0;
-	EX_MEM.forward = 0;
-	branch_taken = FALSE;
-	is_branch_jump = FALSE;
-	branch_not_taken = FALSE;
 	// Init cache to 0
 	cache_misses = 0;
 	cache_hits = 0;
+	CACHE_MISS_PENALTY = 0;
+	perf_reset();
 	int i=0, j=0;
 	for(i=0; i<NUM_CACHE_BLOCKS; i++) {
 		L1Cache.blocks[i].valid = 0;
@@ -2536,29 +1359,23 @@ void print_instruction(uint32_t addr){
 /* Print the current pipeline                                                                                    */ 
 /************************************************************/
 void show_pipeline(){
-	/*IMPLEMENT THIS*/
+	const SS_Slot *latch[4] = { &CURRENT_PIPE.IF_ID, &CURRENT_PIPE.ID_EX, &CURRENT_PIPE.EX_MEM, &CURRENT_PIPE.MEM_WB };
+	const char *name[4] = { "IF/ID", "ID/EX", "EX/MEM", "MEM/WB" };
+	int i;
+
 	printf("\nCurrent PC:[0x%x]\n", CURRENT_STATE.PC);
-	printf("ID_IF.IR:%u\n", ID_IF.IR);
-	print_instruction(ID_IF.PC - 4);
-	printf("ID_IF.PC:%u\n\n", ID_IF.PC);
-	printf("IF_EX.IR:%u\n", IF_EX.IR);
-	print_instruction(ID_IF.PC - 8);
-	printf("IF_EX.A:%u\n", IF_EX.A);
-	printf("IF_EX.B:%u\n", IF_EX.B);
-	printf("IF_EX.RegisterRs:%d\n\n", IF_EX.RegisterRs);
-	printf("IF_EX.RegisterRt:%d\n\n", IF_EX.RegisterRt);
-	printf("IF_EX.imm:%u\n\n", IF_EX.imm);
-	printf("EX_MEM.IR:%u\n", EX_MEM.IR);
-	print_instruction(ID_IF.PC - 12);
-	printf("EX_MEM.A:%u\n", EX_MEM.A);
-	printf("EX_MEM.B:%u\n", EX_MEM.B);
-	printf("EX_MEM.ALUOutput:%u\n\n", EX_MEM.ALUOutput);
-	printf("EX_MEM.RegisterRd:%d\n\n", EX_MEM.RegisterRd);
-	printf("MEM_WB.IR:%u\n", MEM_WB.IR);
-	print_instruction(ID_IF.PC - 16);
-	printf("MEM_WB.ALUOutput:%u\n", MEM_WB.ALUOutput);
-	printf("MEM_WB.LMD:%u\n", MEM_WB.LMD);
-	printf("MEM_WB.RegisterRd:%d\n\n", MEM_WB.RegisterRd);
+	for (i = 0; i < 4; i++) {
+		printf("%-7s", name[i]);
+		if (!latch[i]->valid) {
+			printf("(bubble)\n");
+			continue;
+		}
+		printf("[0x%x]%s\t", latch[i]->pc, i < 2 && CURRENT_PIPE.redirect ? " (squashed)" : "");
+		print_instruction(latch[i]->pc);
+	}
+	if (CURRENT_PIPE.redirect) {
+		printf("Redirect to [0x%x]\n", CURRENT_PIPE.target);
+	}
 	printf("CYCLE %u\n", CYCLE_COUNT);
 	int total_accesses = cache_hits + cache_misses;
 	double hit_rate = (double)cache_hits / (double)total_accesses;
@@ -2568,26 +1385,131 @@ void show_pipeline(){
 	printf("Total Hit: %d\n Total Miss: %d\n Total Accesses: %d\n", cache_hits, cache_misses, total_accesses);
 }
 
+#ifndef MU_MIPS_NO_MAIN
 /***************************************************************/
 /* main                                                                                                                                   */
 /***************************************************************/
+void usage(const char *name) {
+	printf("Usage: %s [options] <input program>\n", name);
+	printf("  -b\t\tbatch mode: no prompt or menus, exit code reports the outcome\n");
+	printf("  -c <cycles>\trun for <cycles> cycles, 0 = to completion (implies -b)\n");
+	printf("  -s <param>=<val>\tset a simulator parameter, may be repeated\n");
+	printf("  -x <script>\tread shell commands from <script> instead of stdin\n");
+	printf("  -t <level>\ttrace level, 0 = silent (batch default), 1 = per instruction\n");
+	printf("  -j <file>\twrite final statistics as JSON on exit (- = stdout)\n");
+	printf("  -v <file>\twrite final statistics as CSV on exit (- = stdout)\n");
+	printf("  -L <addr>=<file>\tcopy the binary <file> into memory at <addr> before running, may be repeated\n");
+	printf("  -o <file>\twrite guest output (print syscalls) to <file> instead of stdout\n");
+	printf("  -i <file>\tread guest input (read_int syscall) from <file> instead of stdin\n");
+	printf("  -T <dest>\tstream interval statistics to a file or unix:<socket> (- = stderr);\n");
+	printf("\t\tthe interval is -s telemetry=<cycles>, default %u\n", TELEMETRY_DEFAULT_INTERVAL);
+	printf("Exit codes in batch mode: %d guest halted, %d usage error, %d stopped before halting,\n"
+		"\t%d guest exited with a non-zero code (syscall 17)\n", EXIT_HALTED, EXIT_USAGE, EXIT_STOPPED, EXIT_GUEST_FAILED);
+}
+
 int main(int argc, char *argv[]) {                              
-	printf("\n**************************\n");
-	printf("Welcome to MU-MIPS SIM...\n");
-	printf("**************************\n\n");
+	int opt, trace = -1, nsets = 0, i;
+	long run_cycles = -1;
+	char *sets[64], *script = NULL, *eq, *telemetry = NULL;
+
+	while ((opt = getopt(argc, argv, "bc:s:x:t:j:v:T:o:i:L:")) != -1) {
+		switch (opt) {
+			case 'b': BATCH_MODE = TRUE; break;
+			case 'c': run_cycles = strtol(optarg, NULL, 0); BATCH_MODE = TRUE; break;
+			case 's':
+				if (nsets < 64) {
+					sets[nsets++] = optarg;
+				}
+				break;
+			case 'x': script = optarg; break;
+			case 't': trace = atoi(optarg); break;
+			case 'j': STATS_JSON_PATH = optarg; break;
+			case 'v': STATS_CSV_PATH = optarg; break;
+			case 'T': telemetry = optarg; break;
+			case 'o':
+				if (!syscall_output(optarg)) {
+					exit(EXIT_USAGE);
+				}
+				break;
+			case 'i':
+				if (!syscall_input(optarg)) {
+					exit(EXIT_USAGE);
+				}
+				break;
+			case 'L':
+				eq = strchr(optarg, '=');
+				if (eq == NULL || MEMIO_NUM_IMPORTS == MEMIO_MAX_IMPORTS) {
+					usage(argv[0]);
+					exit(EXIT_USAGE);
+				}
+				*eq = '\0';
+				MEMIO_IMPORTS[MEMIO_NUM_IMPORTS].addr = strtoul(optarg, NULL, 16);
+				MEMIO_IMPORTS[MEMIO_NUM_IMPORTS++].path = eq + 1;
+				break;
+			default:
+				usage(argv[0]);
+				exit(EXIT_USAGE);
+		}
+	}
 
-	if (argc < 2) {
-		printf("Error: You should provide input file.\nUsage: %s <input program> \n\n",  argv[0]);
-		exit(1);
+	if (!BATCH_MODE) {
+		printf("\n**************************\n");
+		printf("Welcome to MU-MIPS SIM...\n");
+		printf("**************************\n\n");
 	}
 
-	strcpy(prog_file, argv[1]);
+	if (optind >= argc) {
+		printf("Error: You should provide input file.\n");
+		usage(argv[0]);
+		exit(EXIT_USAGE);
+	}
+	if (strlen(argv[optind]) >= sizeof(prog_file)) {
+		printf("Error: Program path is too long (%zu characters at most)\n", sizeof(prog_file) - 1);
+		exit(EXIT_USAGE);
+	}
+	if (script != NULL && freopen(script, "r", stdin) == NULL) {
+		printf("Error: Can't open script file %s\n", script);
+		exit(EXIT_USAGE);
+	}
+
+	strcpy(prog_file, argv[optind]);
+	TRACE_LEVEL = (trace >= 0) ? trace : !BATCH_MODE;
 	initialize();
 	load_program();
-	help();
+	for (i = 0; i < nsets; i++) {
+		eq = strchr(sets[i], '=');
+		if (eq == NULL) {
+			printf("Error: expected <param>=<val>, got %s\n", sets[i]);
+			exit(EXIT_USAGE);
+		}
+		*eq = '\0';
+		set_param(sets[i], strtol(eq + 1, NULL, 0));
+	}
+	for (i = 0; i < MEMIO_NUM_IMPORTS; i++) {
+		if (!memio_load(MEMIO_IMPORTS[i].addr, MEMIO_IMPORTS[i].path)) {
+			exit(EXIT_USAGE);
+		}
+	}
+	if (telemetry != NULL) {
+		telemetry_start(telemetry, TELEMETRY_INTERVAL ? TELEMETRY_INTERVAL : TELEMETRY_DEFAULT_INTERVAL);
+	}
+
+	if (BATCH_MODE && script == NULL) {
+		if (run_cycles > 0) {
+			run(run_cycles);
+		}
+		else {
+			runAll();
+		}
+		sim_exit();
+	}
+	if (!BATCH_MODE) {
+		help();
+	}
 	while (1){
 		handle_command();
 	}
 
 	return 0;
 }
+#endif
@@ -1,10 +1,17 @@
 #include <stdint.h>
+#include <limits.h>
 
 #define FALSE 0
 #define TRUE  1
 #define false 0
 #define true 1
 
+/* State private to one simulated core; each host thread of the parallel engine has its own copy */
+#define CORE_LOCAL __thread
+
+// Statistics shared by cores that may run on different host threads
+#define SHARED_INC(x, n) __atomic_fetch_add(&(x), (n), __ATOMIC_RELAXED)
+
 /******************************************************************************/
 /* MIPS memory layout                                                                                                                                      */
 /******************************************************************************/
@@ -47,55 +54,69 @@ typedef struct CPU_State_Struct {
   uint32_t HI, LO;                          /* special regs for mult/div. */
 } CPU_State;
 
-typedef struct CPU_Pipeline_Reg_Struct{
-	uint32_t PC;
-	uint32_t IR;
-	uint32_t A;
-	uint32_t B;
-	uint32_t imm;
-	uint32_t ALUOutput;
-	uint32_t LMD;
-	uint64_t AA;
-	uint64_t BB;
-	int RegWrite;
-	int MemRead;
-	int FLAG;
-	uint32_t RegisterRd;
-	uint32_t RegisterRs;
-	uint32_t RegisterRt;
-	int forward;
-    int ff;
-    int HI;
-    int LO;
-	
-} CPU_Pipeline_Reg;
+#define REG_HI 32 // HI/LO take part in dependence checks like GPRs
+#define REG_LO 33
+
+typedef enum {
+	SS_ALU,
+	SS_LOAD,
+	SS_STORE,
+	SS_BRANCH,
+	SS_JUMP,
+	SS_MULDIV,
+	SS_SYSCALL
+} ss_class_t;
+
+/* One instruction in flight, decoded at fetch; every pipeline model passes these along */
+typedef struct SS_Slot_Struct {
+	int valid;
+	uint32_t ir, pc;
+	ss_class_t cls;
+	uint8_t src[2];     // registers read, 0 = none
+	uint8_t dest[2];    // registers written, 0 = none
+	uint32_t result[2]; // values for dest[0], dest[1]
+	uint32_t addr;      // load/store effective address
+	uint32_t data;      // store data
+} SS_Slot;
+
+/* The scalar pipeline's latches, one instruction and one cache line each. Stages read only
+   CURRENT_PIPE and each writes only its own latch of NEXT_PIPE, so they may run in any order;
+   pipeline_latch() moves NEXT_PIPE into CURRENT_PIPE once per cycle. The one signal that
+   crosses stages is redirect: a taken branch or jump EX resolved, which squashes the two
+   younger instructions in ID and EX on the next cycle while IF fetches from target */
+typedef struct CPU_Pipeline_Struct{
+	SS_Slot IF_ID __attribute__((aligned(64)));
+	SS_Slot ID_EX __attribute__((aligned(64)));
+	SS_Slot EX_MEM __attribute__((aligned(64)));
+	SS_Slot MEM_WB __attribute__((aligned(64)));
+	int redirect __attribute__((aligned(64)));
+	uint32_t target;
+} CPU_Pipeline;
 
 /***************************************************************/
 /* CPU State info.                                                                                                               */
 /***************************************************************/
 
-CPU_State CURRENT_STATE, NEXT_STATE;
-int RUN_FLAG;	/* run flag*/
-uint32_t INSTRUCTION_COUNT;
+CORE_LOCAL CPU_State CURRENT_STATE, NEXT_STATE;
+CORE_LOCAL int RUN_FLAG;	/* run flag*/
+CORE_LOCAL uint32_t INSTRUCTION_COUNT;
 uint32_t CYCLE_COUNT;
 uint32_t PROGRAM_SIZE; /*in words*/
 int ENABLE_FORWARDING;
-int ForwardA;
-int ForwardB;
-int is_branch_jump;
-int branch_taken;
-int branch_not_taken;
+int TRACE_LEVEL;	/* 0 = silent pipeline, 1 = per-instruction trace */
+
+void (*PIPELINE)();	/* backend cycle core_cycle() runs, see pipeline_select() */
+
+#define TRACE(...) do { if (TRACE_LEVEL) printf(__VA_ARGS__); } while (0)
+#define TRACE_INSTRUCTION(addr) do { if (TRACE_LEVEL) print_instruction(addr); } while (0)
 
 
 /***************************************************************/
 /* Pipeline Registers.                                                                                                        */
 /***************************************************************/
-CPU_Pipeline_Reg ID_IF;
-CPU_Pipeline_Reg IF_EX;
-CPU_Pipeline_Reg EX_MEM;
-CPU_Pipeline_Reg MEM_WB;
+CORE_LOCAL CPU_Pipeline CURRENT_PIPE, NEXT_PIPE;
 
-char prog_file[32];
+char prog_file[PATH_MAX];
 
 
 /***************************************************************/
@@ -105,6 +126,7 @@ void help();
 uint32_t mem_read_32(uint32_t address);
 void mem_write_32(uint32_t address, uint32_t value);
 void cycle();
+void core_cycle();
 void run(int num_cycles);
 void runAll();
 void mdump(uint32_t start, uint32_t stop) ;
@@ -116,10 +138,17 @@ void load_program();
 void handle_pipeline(); /*IMPLEMENT THIS*/
 void WB();/*IMPLEMENT THIS*/
 void MEM();/*IMPLEMENT THIS*/
+void mem_access_done(uint32_t ir, uint32_t pc, uint32_t addr, int missed);
 void EX();/*IMPLEMENT THIS*/
 void ID();/*IMPLEMENT THIS*/
 void IF();/*IMPLEMENT THIS*/
+void pipeline_select();
+void pipeline_clear();
+void pipeline_latch();
+void pipeline_flush();
+uint32_t pipeline_ex_ir();
 void show_pipeline();/*IMPLEMENT THIS*/
 void initialize();
 void print_program(); /*IMPLEMENT THIS*/
 void print_instruction(uint32_t addr);
+void set_param(const char *name, int value);
@@ -0,0 +1,171 @@
+/******************************************************************************/
+/* NON-BLOCKING DATA CACHE: MISS STATUS HOLDING REGISTERS                     */
+/******************************************************************************/
+#define MAX_MSHRS 16
+
+/* One outstanding line fill */
+typedef struct MSHR_Struct {
+	int valid;
+	uint32_t line;      // addr >> 4
+	uint32_t ready;     // core cycle the fill completes
+	uint32_t merged;    // secondary misses folded into this fill
+} MSHR;
+
+/* One core's MSHR file and load scoreboard */
+typedef struct MSHR_File_Struct {
+	MSHR entries[MAX_MSHRS];
+	uint32_t now;                   // cycles this core has run; CYCLE_COUNT only moves per quantum in parallel runs
+	uint32_t reg_ready[MIPS_REGS];  // cycle each pending load destination becomes available
+	uint32_t busy_until;            // last cycle any fill is outstanding, for MLP accounting
+} MSHR_File;
+
+uint32_t MSHR_COUNT;                // 0 = blocking cache
+MSHR_File MSHR_STATE[MAX_CORES];    // indexed by CURRENT_CORE
+
+/* Statistics, shared by all cores */
+uint64_t MSHR_PRIMARY;              // misses that allocated an MSHR
+uint64_t MSHR_SECONDARY;            // accesses merged into a fill already in flight
+uint64_t MSHR_HIT_UNDER_MISS;       // hits that proceeded while a fill was outstanding
+uint64_t MSHR_FULL_STALLS;          // primary misses that found every MSHR busy
+uint64_t MSHR_FULL_CYCLES;
+uint64_t MSHR_DEP_CYCLES;           // cycles frozen on a register a fill will write
+uint64_t MSHR_MISS_CYCLES;          // sum of fill latencies
+uint64_t MSHR_BUSY_CYCLES;          // cycles with at least one fill outstanding
+uint64_t MSHR_OCCUPANCY[MAX_MSHRS + 1]; // fills already outstanding when a primary miss allocates
+
+void mshr_reset() {
+	memset(MSHR_STATE, 0, sizeof(MSHR_STATE));
+	MSHR_PRIMARY = MSHR_SECONDARY = MSHR_HIT_UNDER_MISS = 0;
+	MSHR_FULL_STALLS = MSHR_FULL_CYCLES = MSHR_DEP_CYCLES = 0;
+	MSHR_MISS_CYCLES = MSHR_BUSY_CYCLES = 0;
+	memset(MSHR_OCCUPANCY, 0, sizeof(MSHR_OCCUPANCY));
+}
+
+/***************************************************************/
+/* Called from MEM() after every demand load or store: turns   */
+/* a miss into an outstanding fill instead of a pipeline freeze */
+/***************************************************************/
+void mshr_access(uint32_t opcode, uint32_t ir, uint32_t addr, int missed) {
+	MSHR_File *f = &MSHR_STATE[CURRENT_CORE];
+	MSHR *m = NULL, *slot = NULL;
+	uint32_t line = addr >> 4, dest, start, ready = 0, outstanding = 0, i;
+
+	switch (opcode) {
+		case 0x20: case 0x21: case 0x23: dest = (ir & 0x001F0000) >> 16; break; // LB, LH, LW
+		case 0x2B: dest = 0; break;                                            // SW
+		default: return;                                                       // SB, SH bypass the L1
+	}
+	if (CACHE_MISS_PENALTY == 0 && !DRAM_ENABLED) {
+		return;
+	}
+
+	for (i = 0; i < MSHR_COUNT; i++) {
+		if (f->entries[i].valid && f->entries[i].ready <= f->now) {
+			f->entries[i].valid = FALSE; // fill completed
+		}
+		if (!f->entries[i].valid) {
+			continue;
+		}
+		outstanding++;
+		if (f->entries[i].line == line) {
+			m = &f->entries[i];
+		}
+	}
+
+	if (m) { // secondary miss: wait on the fill already in flight
+		m->merged++;
+		ready = m->ready;
+		SHARED_INC(MSHR_SECONDARY, 1);
+	}
+	else if (missed) {
+		start = f->now;
+		if (outstanding == MSHR_COUNT) { // structural stall until the oldest fill returns
+			slot = &f->entries[0];
+			for (i = 1; i < MSHR_COUNT; i++) {
+				if (f->entries[i].ready < slot->ready) {
+					slot = &f->entries[i];
+				}
+			}
+			start = slot->ready;
+			MEM_STALL_CYCLES += start - f->now;
+			SHARED_INC(MSHR_FULL_STALLS, 1);
+			SHARED_INC(MSHR_FULL_CYCLES, start - f->now);
+			outstanding--;
+		}
+		else {
+			for (i = 0; f->entries[i].valid; i++);
+			slot = &f->entries[i];
+		}
+		ready = start + mem_fill_latency(addr, start);
+		slot->valid = TRUE;
+		slot->line = line;
+		slot->ready = ready;
+		slot->merged = 0;
+		SHARED_INC(MSHR_PRIMARY, 1);
+		SHARED_INC(MSHR_OCCUPANCY[outstanding], 1);
+		SHARED_INC(MSHR_MISS_CYCLES, ready - start);
+		if (ready > f->busy_until) { // fills from DRAM can return out of order
+			SHARED_INC(MSHR_BUSY_CYCLES, ready - (f->busy_until > start ? f->busy_until : start));
+			f->busy_until = ready;
+		}
+	}
+	else if (outstanding) {
+		SHARED_INC(MSHR_HIT_UNDER_MISS, 1);
+	}
+	if (dest) {
+		f->reg_ready[dest] = ready; // a hit also overwrites any older pending value
+	}
+}
+
+/* MSHR cycle by which every register instruction ir reads or writes has been filled */
+uint32_t mshr_ready(uint32_t ir) {
+	MSHR_File *f = &MSHR_STATE[CURRENT_CORE];
+	uint32_t opcode = (ir & 0xFC000000) >> 26;
+	uint32_t rs = (ir & 0x03E00000) >> 21, rt = (ir & 0x001F0000) >> 16;
+
+	if (ir == 0 || ir == 0x00000001 || opcode == 0x02 || opcode == 0x03) { // empty slot, bubble, J/JAL
+		return 0;
+	}
+	return f->reg_ready[rs] > f->reg_ready[rt] ? f->reg_ready[rs] : f->reg_ready[rt];
+}
+
+/* TRUE while instruction ir reads or writes a register a fill will produce */
+int mshr_waits(uint32_t ir) {
+	return mshr_ready(ir) > MSHR_STATE[CURRENT_CORE].now;
+}
+
+/***************************************************************/
+/* Called from core_cycle(): TRUE while the instruction about  */
+/* to execute waits on a fill                                  */
+/***************************************************************/
+int mshr_stall() {
+	if (mshr_waits(pipeline_ex_ir())) {
+		SHARED_INC(MSHR_DEP_CYCLES, 1);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/************************************************************/
+/* Print MSHR usage and memory-level parallelism            */
+/************************************************************/
+void mshr_dump() {
+	uint32_t i;
+
+	printf("-------------------------------------------------------------\n");
+	printf("MSHRs: %u%s\n", MSHR_COUNT, MSHR_COUNT ? "" : " (blocking cache)");
+	printf("-------------------------------------------------------------\n");
+	printf("primary misses\t%llu\n", (unsigned long long)MSHR_PRIMARY);
+	printf("secondary\t%llu\tmerged into a fill in flight\n", (unsigned long long)MSHR_SECONDARY);
+	printf("hit under miss\t%llu\n", (unsigned long long)MSHR_HIT_UNDER_MISS);
+	printf("MSHRs full\t%llu\t(%llu cycles)\n", (unsigned long long)MSHR_FULL_STALLS, (unsigned long long)MSHR_FULL_CYCLES);
+	printf("dependence\t%llu\tcycles waiting on a fill\n", (unsigned long long)MSHR_DEP_CYCLES);
+	printf("busy cycles\t%llu\tat least one fill outstanding\n", (unsigned long long)MSHR_BUSY_CYCLES);
+	printf("MLP\t\t%.2f\tfill cycles / busy cycles\n", MSHR_BUSY_CYCLES ? (double)MSHR_MISS_CYCLES / MSHR_BUSY_CYCLES : 0.0);
+	printf("-------------------------------------------------------------\n");
+	printf("[Outstanding]\t[Primary misses]\n");
+	for (i = 0; i < MSHR_COUNT; i++) {
+		printf("%u\t\t%llu\n", i, (unsigned long long)MSHR_OCCUPANCY[i]);
+	}
+	printf("-------------------------------------------------------------\n");
+}
@@ -0,0 +1,252 @@
+/******************************************************************************/
+/* MULTI-CORE SIMULATION WITH MESI SNOOPING COHERENCE                         */
+/******************************************************************************/
+#define MAX_CORES   64
+#define CORE_ID_REG 26 // $k0 holds the core ID when a shared program runs on several cores
+
+typedef enum {
+	MESI_I,
+	MESI_S,
+	MESI_E,
+	MESI_M
+} mesi_state_t;
+
+typedef enum {
+	BUS_RD,   // read miss
+	BUS_RDX,  // write miss: read with intent to modify
+	BUS_UPGR, // write hit on a shared line
+	BUS_WR    // byte/halfword store straight to memory
+} bus_op_t;
+
+/* Everything one core owns; the running core's copy lives in the usual globals */
+typedef struct Core_Struct {
+	CPU_State CURRENT_STATE, NEXT_STATE;
+	CPU_Pipeline PIPE;
+	Cache L1Cache;
+	uint8_t mesi[NUM_CACHE_BLOCKS];
+	uint32_t MEM_STALL_CYCLES;
+	int halted;
+} Core;
+
+/* Per-core statistics, never swapped */
+typedef struct Core_Stats_Struct {
+	uint64_t cycles;        // cycles the core was running
+	uint64_t instructions;
+	uint64_t cache_hits, cache_misses;
+	uint64_t bus_rd, bus_rdx, bus_upgr, bus_wr;
+	uint64_t inval_sent;    // lines this core invalidated in other caches
+	uint64_t inval_recv;    // lines other cores invalidated in this cache
+	uint64_t flushes;       // snoops that hit a line this core held Modified
+} Core_Stats;
+
+int NUM_CORES = 1;
+CORE_LOCAL int CURRENT_CORE;            // core whose state is in the globals
+Core CORES[MAX_CORES];
+Core_Stats CORE_STATS[MAX_CORES];
+CORE_LOCAL uint8_t MESI_STATE[NUM_CACHE_BLOCKS]; // MESI state of the running core's L1Cache lines
+int PARALLEL_ACTIVE;                    // cores are running on their own host threads
+pthread_mutex_t TAGS_LOCK = PTHREAD_MUTEX_INITIALIZER; // L1 tags and MESI state, which parallel_snoop() reads across threads
+
+void tags_lock() {
+	if (PARALLEL_ACTIVE) {
+		pthread_mutex_lock(&TAGS_LOCK);
+	}
+}
+
+void tags_unlock() {
+	if (PARALLEL_ACTIVE) {
+		pthread_mutex_unlock(&TAGS_LOCK);
+	}
+}
+
+int parallel_snoop(bus_op_t op, uint32_t addr);
+int victim_snoop(int core, bus_op_t op, uint32_t addr);
+
+void core_save(Core *c) {
+	c->CURRENT_STATE = CURRENT_STATE;
+	c->NEXT_STATE = NEXT_STATE;
+	c->PIPE = CURRENT_PIPE;
+	c->L1Cache = L1Cache;
+	memcpy(c->mesi, MESI_STATE, sizeof(MESI_STATE));
+	c->MEM_STALL_CYCLES = MEM_STALL_CYCLES;
+}
+
+void core_load(Core *c) {
+	CURRENT_STATE = c->CURRENT_STATE;
+	NEXT_STATE = c->NEXT_STATE;
+	CURRENT_PIPE = c->PIPE;
+	L1Cache = c->L1Cache;
+	memcpy(MESI_STATE, c->mesi, sizeof(MESI_STATE));
+	MEM_STALL_CYCLES = c->MEM_STALL_CYCLES;
+}
+
+/* Make core n the one the globals describe */
+void core_switch(int n) {
+	if (n == CURRENT_CORE) {
+		return;
+	}
+	core_save(&CORES[CURRENT_CORE]);
+	core_load(&CORES[n]);
+	CURRENT_CORE = n;
+}
+
+/***************************************************************/
+/* Start n cores from the current state, core ID in $k0        */
+/***************************************************************/
+void multicore_init(int n) {
+	int i, j;
+
+	if (n < 1 || n > MAX_CORES) {
+		printf("Number of cores must be between 1 and %d\n", MAX_CORES);
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		core_save(&CORES[i]);
+		for (j = 0; j < NUM_CACHE_BLOCKS; j++) {
+			CORES[i].L1Cache.blocks[j].valid = 0;
+			CORES[i].mesi[j] = MESI_I;
+		}
+		if (n > 1) {
+			CORES[i].CURRENT_STATE.REGS[CORE_ID_REG] = i;
+			CORES[i].NEXT_STATE.REGS[CORE_ID_REG] = i;
+		}
+		CORES[i].halted = FALSE;
+	}
+	memset(CORE_STATS, 0, sizeof(CORE_STATS));
+	NUM_CORES = n;
+	CURRENT_CORE = 0;
+	core_load(&CORES[0]);
+	RUN_FLAG = TRUE;
+}
+
+/* Broadcast op for the line holding addr to every other core; TRUE when another cache holds it */
+int mesi_snoop(bus_op_t op, uint32_t addr) {
+	uint32_t index = (addr & 0x000000F0) >> 4;
+	uint32_t tag = (addr & 0xFFFFFF00) >> 8;
+	CacheBlock *block;
+	uint8_t *state;
+	int i, shared = FALSE;
+
+	if (PARALLEL_ACTIVE) {
+		return parallel_snoop(op, addr);
+	}
+	for (i = 0; i < NUM_CORES; i++) {
+		block = &CORES[i].L1Cache.blocks[index];
+		state = &CORES[i].mesi[index];
+		if (i != CURRENT_CORE && VICTIM_ENTRIES && victim_snoop(i, op, addr)) {
+			shared = TRUE;
+		}
+		if (i == CURRENT_CORE || !block->valid || block->tag != tag || *state == MESI_I) {
+			continue;
+		}
+		shared = TRUE;
+		if (*state == MESI_M) {
+			CORE_STATS[i].flushes++; // stores are written through, so memory already holds the data
+		}
+		if (op == BUS_RD) {
+			*state = MESI_S;
+		}
+		else {
+			*state = MESI_I;
+			block->valid = 0;
+			CORE_STATS[i].inval_recv++;
+			CORE_STATS[CURRENT_CORE].inval_sent++;
+		}
+	}
+	return shared;
+}
+
+/***************************************************************/
+/* Called from MEM() after a load or store when NUM_CORES > 1  */
+/***************************************************************/
+void mesi_access(uint32_t opcode, uint32_t addr, int missed) {
+	uint32_t index = (addr & 0x000000F0) >> 4;
+	Core_Stats *stats = &CORE_STATS[CURRENT_CORE];
+	int shared;
+
+	switch (opcode) {
+		case 0x20: case 0x21: case 0x23: // LB, LH, LW
+			if (missed) {
+				stats->bus_rd++;
+				shared = mesi_snoop(BUS_RD, addr);
+				tags_lock();
+				MESI_STATE[index] = shared ? MESI_S : MESI_E;
+				tags_unlock();
+			}
+			break;
+		case 0x2B: // SW
+			if (missed) {
+				stats->bus_rdx++;
+				mesi_snoop(BUS_RDX, addr);
+			}
+			else if (MESI_STATE[index] == MESI_S) {
+				stats->bus_upgr++;
+				mesi_snoop(BUS_UPGR, addr);
+			}
+			tags_lock();
+			MESI_STATE[index] = MESI_M;
+			tags_unlock();
+			break;
+		case 0x28: case 0x29: // SB, SH bypass the L1
+			stats->bus_wr++;
+			mesi_snoop(BUS_WR, addr);
+			break;
+	}
+}
+
+/***************************************************************/
+/* One cycle of every running core, in core order              */
+/***************************************************************/
+void multicore_cycle() {
+	uint32_t instructions, hits, misses;
+	int i, running = FALSE;
+
+	for (i = 0; i < NUM_CORES; i++) {
+		if (CORES[i].halted) {
+			continue;
+		}
+		core_switch(i);
+		instructions = INSTRUCTION_COUNT;
+		hits = cache_hits;
+		misses = cache_misses;
+		RUN_FLAG = TRUE;
+		core_cycle();
+		CORE_STATS[i].cycles++;
+		CORE_STATS[i].instructions += INSTRUCTION_COUNT - instructions;
+		CORE_STATS[i].cache_hits += cache_hits - hits;
+		CORE_STATS[i].cache_misses += cache_misses - misses;
+		CORES[i].halted = !RUN_FLAG;
+		running |= RUN_FLAG;
+	}
+	RUN_FLAG = running;
+}
+
+/************************************************************/
+/* Print per-core execution and coherence statistics        */
+/************************************************************/
+void multicore_dump() {
+	Core_Stats *s;
+	int i;
+
+	printf("-------------------------------------------------------------\n");
+	printf("Cores: %d (showing core %d)\n", NUM_CORES, CURRENT_CORE);
+	printf("-------------------------------------------------------------\n");
+	printf("[Core]\t[PC]\t\t[State]\t[Cycles]\t[Instrs]\t[Hits]\t[Misses]\n");
+	for (i = 0; i < NUM_CORES; i++) {
+		s = &CORE_STATS[i];
+		printf("%d\t0x%08x\t%s\t%llu\t\t%llu\t\t%llu\t%llu\n", i,
+			i == CURRENT_CORE ? CURRENT_STATE.PC : CORES[i].CURRENT_STATE.PC, CORES[i].halted ? "halted" : "run",
+			(unsigned long long)s->cycles, (unsigned long long)s->instructions,
+			(unsigned long long)s->cache_hits, (unsigned long long)s->cache_misses);
+	}
+	printf("-------------------------------------------------------------\n");
+	printf("[Core]\t[BusRd]\t[BusRdX]\t[BusUpgr]\t[BusWr]\t[InvSent]\t[InvRecv]\t[Flush]\n");
+	for (i = 0; i < NUM_CORES; i++) {
+		s = &CORE_STATS[i];
+		printf("%d\t%llu\t%llu\t\t%llu\t\t%llu\t%llu\t\t%llu\t\t%llu\n", i,
+			(unsigned long long)s->bus_rd, (unsigned long long)s->bus_rdx, (unsigned long long)s->bus_upgr,
+			(unsigned long long)s->bus_wr, (unsigned long long)s->inval_sent, (unsigned long long)s->inval_recv,
+			(unsigned long long)s->flushes);
+	}
+	printf("-------------------------------------------------------------\n");
+}
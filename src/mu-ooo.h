@@ -0,0 +1,471 @@
+/******************************************************************************/
+/* OUT-OF-ORDER BACKEND: TOMASULO SCHEDULING WITH A REORDER BUFFER            */
+/******************************************************************************/
+#define OOO_MAX_WIDTH 4
+#define OOO_MAX_ROB   128
+#define OOO_MAX_RS    64
+#define OOO_MAX_LSQ   64
+#define OOO_REGS      (REG_LO + 1) // GPRs plus HI/LO are renamed
+
+typedef enum {
+	OOO_WAITING,    // in a reservation station
+	OOO_EXECUTING,  // issued, result on the CDB at done
+	OOO_DONE        // result broadcast, waiting to commit
+} ooo_state_t;
+
+/* One reorder buffer entry; the decoded instruction and its results live in s */
+typedef struct OOO_Entry_Struct {
+	SS_Slot s;
+	uint64_t seq;           // program order, for age comparisons across the circular buffers
+	ooo_state_t state;
+	int tag[2];             // ROB index producing src[k], -1 once the value is captured
+	uint32_t value[2];      // operand values for src[0], src[1]
+	uint32_t done;          // cycle the result reaches the CDB
+	uint32_t predicted;     // fetch PC after this instruction, as the front end guessed it
+	uint32_t target;        // actual next PC, known once executed
+} OOO_Entry;
+
+/* One core's out-of-order backend */
+typedef struct OOO_Core_Struct {
+	SS_Slot fetch[2 * OOO_MAX_WIDTH];   // fetch queue, oldest first
+	uint32_t fetch_next[2 * OOO_MAX_WIDTH]; // predicted PC after each fetched instruction
+	int fetched;
+	OOO_Entry rob[OOO_MAX_ROB];
+	int head, count;
+	int rat[OOO_REGS];                  // register alias table: ROB index of the newest producer, -1 = register file
+	int rs[OOO_MAX_RS], rs_count;       // reservation stations, ROB indices
+	int lsq[OOO_MAX_LSQ], lsq_head, lsq_count; // loads and stores in program order, ROB indices
+	uint64_t seq;
+	uint32_t now;
+	uint32_t unit_busy[NUM_FUNITS];     // multiplier/divider occupancy, in this backend's cycles
+	int refill;                         // the backend drained after a misprediction
+} OOO_Core;
+
+int OOO_ENABLED;                    // 0 = the in-order pipelines
+uint32_t OOO_WIDTH = 2;             // fetch, dispatch, issue and commit width
+uint32_t OOO_ROB_SIZE = 32;
+uint32_t OOO_RS_SIZE = 16;
+uint32_t OOO_LSQ_SIZE = 16;
+OOO_Core OOO_STATE[MAX_CORES];      // indexed by CURRENT_CORE
+
+/* Statistics, shared by all cores */
+uint64_t OOO_CYCLES;
+uint64_t OOO_DISPATCHED;
+uint64_t OOO_SQUASHED;              // wrong-path instructions removed from the ROB
+uint64_t OOO_BRANCHES;              // branches and jumps resolved
+uint64_t OOO_MISPREDICTS;
+uint64_t OOO_FORWARDED;             // loads served from an older store in the LSQ
+uint64_t OOO_LOAD_BLOCKED;          // cycles a ready load waited on an older store
+uint64_t OOO_ROB_FULL, OOO_RS_FULL, OOO_LSQ_FULL; // dispatch stall cycles, by structure
+uint64_t OOO_ROB_OCCUPANCY;         // summed per cycle, for the mean
+
+/* Empty one core's backend: every register reads from the register file */
+void ooo_reset_core(OOO_Core *o) {
+	int r;
+
+	memset(o, 0, sizeof(*o));
+	for (r = 0; r < OOO_REGS; r++) {
+		o->rat[r] = -1;
+	}
+}
+
+void ooo_reset() {
+	int c;
+
+	for (c = 0; c < MAX_CORES; c++) {
+		ooo_reset_core(&OOO_STATE[c]);
+	}
+	OOO_CYCLES = OOO_DISPATCHED = OOO_SQUASHED = OOO_BRANCHES = OOO_MISPREDICTS = 0;
+	OOO_FORWARDED = OOO_LOAD_BLOCKED = OOO_ROB_FULL = OOO_RS_FULL = OOO_LSQ_FULL = OOO_ROB_OCCUPANCY = 0;
+}
+
+/* PC of the oldest instruction o has not committed: the ROB head, else the fetch queue; pc when both are empty */
+uint32_t ooo_oldest_pc(OOO_Core *o, uint32_t pc) {
+	if (o->count > 0) {
+		return o->rob[o->head].s.pc;
+	}
+	return o->fetched > 0 ? o->fetch[0].pc : pc;
+}
+
+/* set ooo* parameters; any change starts from an empty backend at the oldest instruction not retired */
+void ooo_set(const char *name, int value) {
+	uint32_t *param = NULL, max = 0;
+
+	if (strcmp(name, "ooo") == 0) {
+		pipeline_flush();
+		OOO_ENABLED = value != 0;
+	}
+	else if (strcmp(name, "ooo_width") == 0) { param = &OOO_WIDTH; max = OOO_MAX_WIDTH; }
+	else if (strcmp(name, "ooo_rob") == 0) { param = &OOO_ROB_SIZE; max = OOO_MAX_ROB; }
+	else if (strcmp(name, "ooo_rs") == 0) { param = &OOO_RS_SIZE; max = OOO_MAX_RS; }
+	else if (strcmp(name, "ooo_lsq") == 0) { param = &OOO_LSQ_SIZE; max = OOO_MAX_LSQ; }
+	else {
+		printf("Unknown out-of-order parameter %s\n", name);
+		return;
+	}
+	if (param) {
+		if (value < 1 || value > (int)max) {
+			printf("%s must be between 1 and %u\n", name, max);
+			return;
+		}
+		pipeline_flush();
+		*param = value;
+	}
+	ooo_reset();
+	printf("Out-of-order backend %s: %u-wide, %u ROB entries, %u reservation stations, %u LSQ entries\n",
+		OOO_ENABLED ? "ON" : "OFF", OOO_WIDTH, OOO_ROB_SIZE, OOO_RS_SIZE, OOO_LSQ_SIZE);
+}
+
+/* Value entry e produces for register r */
+uint32_t ooo_result(OOO_Entry *e, uint8_t r) {
+	return e->s.dest[1] == r ? e->s.result[1] : e->s.result[0];
+}
+
+/* Architectural value of register r */
+uint32_t ooo_arch(uint8_t r) {
+	return r == REG_HI ? CURRENT_STATE.HI : r == REG_LO ? CURRENT_STATE.LO : CURRENT_STATE.REGS[r];
+}
+
+/* Static prediction at fetch: J/JAL go to their target, backward branches are taken */
+uint32_t ooo_predict(SS_Slot *s) {
+	uint32_t opcode = (s->ir & 0xFC000000) >> 26, imm = s->ir & 0x0000FFFF;
+
+	if (opcode == 0x02 || opcode == 0x03) {
+		return (s->pc & 0xF0000000) | ((s->ir & 0x03FFFFFF) << 2);
+	}
+	if (s->cls == SS_BRANCH && (imm & 0x8000)) {
+		return s->pc + ((imm | 0xFFFF0000) << 2);
+	}
+	return s->pc + 4; // JR/JALR fall through and always recover
+}
+
+/* Rebuild the alias table from the entries still in the ROB */
+void ooo_rename_rebuild(OOO_Core *o) {
+	int i, k, idx;
+
+	for (i = 0; i < OOO_REGS; i++) {
+		o->rat[i] = -1;
+	}
+	for (i = 0; i < o->count; i++) {
+		idx = (o->head + i) % OOO_ROB_SIZE;
+		for (k = 0; k < 2; k++) {
+			if (o->rob[idx].s.dest[k] != 0) {
+				o->rat[o->rob[idx].s.dest[k]] = idx;
+			}
+		}
+	}
+}
+
+/***************************************************************/
+/* Branch recovery: drop every entry younger than ROB index    */
+/* idx from the ROB, reservation stations, LSQ and front end   */
+/***************************************************************/
+void ooo_squash(OOO_Core *o, int idx) {
+	uint64_t seq = o->rob[idx].seq;
+	int i, n;
+
+	while (o->count > 0 && o->rob[(o->head + o->count - 1) % OOO_ROB_SIZE].seq > seq) {
+		o->count--;
+		SHARED_INC(OOO_SQUASHED, 1);
+	}
+	for (n = 0, i = 0; i < o->rs_count; i++) {
+		if (o->rob[o->rs[i]].seq <= seq) {
+			o->rs[n++] = o->rs[i];
+		}
+	}
+	o->rs_count = n;
+	while (o->lsq_count > 0 && o->rob[o->lsq[(o->lsq_head + o->lsq_count - 1) % OOO_LSQ_SIZE]].seq > seq) {
+		o->lsq_count--;
+	}
+	SHARED_INC(OOO_SQUASHED, o->fetched);
+	o->fetched = 0;
+	ooo_rename_rebuild(o);
+	CURRENT_STATE.PC = o->rob[idx].target;
+	o->refill = TRUE;
+}
+
+/***************************************************************/
+/* Memory disambiguation for the load at ROB index idx: TRUE   */
+/* when it may execute, with *fwd set when an older SW to the  */
+/* same word supplies the data                                 */
+/***************************************************************/
+int ooo_load_ready(OOO_Core *o, int idx, OOO_Entry **fwd) {
+	OOO_Entry *ld = &o->rob[idx], *st;
+	int i;
+
+	*fwd = NULL;
+	for (i = 0; i < o->lsq_count; i++) {
+		st = &o->rob[o->lsq[(o->lsq_head + i) % OOO_LSQ_SIZE]];
+		if (st->seq >= ld->seq) {
+			break;
+		}
+		if (st->s.cls != SS_STORE) {
+			continue;
+		}
+		if (st->state == OOO_WAITING) { // address unknown: no speculation past it
+			return FALSE;
+		}
+		if ((st->s.addr & ~3u) == (ld->s.addr & ~3u)) {
+			*fwd = st; // the youngest older match wins
+		}
+	}
+	if (*fwd && ((*fwd)->s.ir & 0xFC000000) >> 26 != 0x2B) { // SB/SH merge into memory at commit
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Put the result of ROB index idx on the CDB; resolve it if it is a branch */
+void ooo_writeback(OOO_Core *o, int idx) {
+	OOO_Entry *e = &o->rob[idx], *w;
+	int i, k;
+
+	e->state = OOO_DONE;
+	for (i = 0; i < o->rs_count; i++) {
+		w = &o->rob[o->rs[i]];
+		for (k = 0; k < 2; k++) {
+			if (w->tag[k] == idx) {
+				w->value[k] = ooo_result(e, w->s.src[k]);
+				w->tag[k] = -1;
+			}
+		}
+	}
+	if (e->s.cls == SS_BRANCH || e->s.cls == SS_JUMP) {
+		SHARED_INC(OOO_BRANCHES, 1);
+		if (e->target != e->predicted) {
+			SHARED_INC(OOO_MISPREDICTS, 1);
+			ooo_squash(o, idx);
+		}
+	}
+}
+
+/***************************************************************/
+/* Execute ROB index idx; FALSE when it must stay in its       */
+/* reservation station                                          */
+/***************************************************************/
+int ooo_issue(OOO_Core *o, int idx, int *mem_port) {
+	OOO_Entry *e = &o->rob[idx], *fwd;
+	SS_Slot saved = e->s;
+	uint32_t target, ready;
+	int k, u = fu_unit(e->s.ir);
+
+	if (u >= 0 && o->unit_busy[u] > o->now) { // unpipelined unit still working
+		SHARED_INC(FU_BUSY_CYCLES[u], 1);
+		return FALSE;
+	}
+	e->target = e->s.pc + 4;
+	if (ss_evaluate(&e->s, e->value[0], e->value[1], &target)) {
+		e->target = target;
+	}
+	if (e->s.dest[0] != saved.dest[0] || e->s.dest[1] != saved.dest[1]) { // no result, e.g. DIV by zero: keep the old values
+		if (idx != o->head) {
+			e->s = saved; // needs the architectural values, so waits to be oldest
+			return FALSE;
+		}
+		for (k = 0; k < 2; k++) {
+			e->s.dest[k] = saved.dest[k];
+			e->s.result[k] = ooo_arch(saved.dest[k]);
+		}
+	}
+	e->done = u >= 0 ? fu_reserve(&o->unit_busy[u], u, o->now) : o->now + 1;
+	if (e->s.cls == SS_LOAD) {
+		if (*mem_port || !ooo_load_ready(o, idx, &fwd)) {
+			SHARED_INC(OOO_LOAD_BLOCKED, !*mem_port);
+			return FALSE;
+		}
+		*mem_port = TRUE;
+		if (fwd) {
+			e->s.result[0] = ss_load_value(&e->s, fwd->s.data);
+			SHARED_INC(OOO_FORWARDED, 1);
+		}
+		else {
+			ss_memory(&e->s);
+			if (MSHR_COUNT) { // the fill completes behind the backend instead of freezing it
+				ready = MSHR_STATE[CURRENT_CORE].reg_ready[e->s.dest[0]];
+				if (ready > MSHR_STATE[CURRENT_CORE].now) {
+					e->done += ready - MSHR_STATE[CURRENT_CORE].now;
+				}
+			}
+		}
+	}
+	e->state = OOO_EXECUTING;
+	return TRUE;
+}
+
+/***************************************************************/
+/* Rename s into the ROB, a reservation station and the LSQ;   */
+/* FALSE when a structure is full                               */
+/***************************************************************/
+int ooo_dispatch(OOO_Core *o, SS_Slot *s, uint32_t predicted) {
+	OOO_Entry *e;
+	int idx, k, p, mem = s->cls == SS_LOAD || s->cls == SS_STORE;
+
+	if (o->count == (int)OOO_ROB_SIZE) {
+		SHARED_INC(OOO_ROB_FULL, 1);
+		return FALSE;
+	}
+	if (o->rs_count == (int)OOO_RS_SIZE) {
+		SHARED_INC(OOO_RS_FULL, 1);
+		return FALSE;
+	}
+	if (mem && o->lsq_count == (int)OOO_LSQ_SIZE) {
+		SHARED_INC(OOO_LSQ_FULL, 1);
+		return FALSE;
+	}
+	idx = (o->head + o->count++) % OOO_ROB_SIZE;
+	e = &o->rob[idx];
+	memset(e, 0, sizeof(*e));
+	e->s = *s;
+	e->seq = ++o->seq;
+	e->state = OOO_WAITING;
+	e->predicted = predicted;
+	for (k = 0; k < 2; k++) {
+		p = s->src[k] ? o->rat[s->src[k]] : -1;
+		e->tag[k] = -1;
+		if (p < 0) {
+			e->value[k] = s->src[k] ? ooo_arch(s->src[k]) : 0;
+		}
+		else if (o->rob[p].state == OOO_DONE) {
+			e->value[k] = ooo_result(&o->rob[p], s->src[k]);
+		}
+		else {
+			e->tag[k] = p;
+		}
+	}
+	for (k = 0; k < 2; k++) {
+		if (s->dest[k] != 0) {
+			o->rat[s->dest[k]] = idx;
+		}
+	}
+	o->rs[o->rs_count++] = idx;
+	if (mem) {
+		o->lsq[(o->lsq_head + o->lsq_count++) % OOO_LSQ_SIZE] = idx;
+	}
+	SHARED_INC(OOO_DISPATCHED, 1);
+	return TRUE;
+}
+
+/***************************************************************/
+/* One cycle of the out-of-order core, back to front: commit,  */
+/* writeback, issue, dispatch, fetch                            */
+/***************************************************************/
+void ooo_cycle() {
+	OOO_Core *o = &OOO_STATE[CURRENT_CORE];
+	OOO_Entry *e;
+	int i, k, n, idx, stored = FALSE, mem_port = FALSE;
+
+	o->now++;
+	SHARED_INC(OOO_CYCLES, 1);
+	SHARED_INC(OOO_ROB_OCCUPANCY, o->count);
+
+	/* Commit: in order from the ROB head; stores write the cache here, one per cycle */
+	for (n = 0; n < (int)OOO_WIDTH && o->count > 0; n++) {
+		e = &o->rob[o->head];
+		if (e->state != OOO_DONE || (e->s.cls == SS_STORE && stored)) {
+			break;
+		}
+		if (e->s.cls == SS_STORE) {
+			ss_memory(&e->s);
+			stored = TRUE;
+		}
+		if (e->s.cls == SS_LOAD || e->s.cls == SS_STORE) {
+			o->lsq_head = (o->lsq_head + 1) % OOO_LSQ_SIZE;
+			o->lsq_count--;
+		}
+		for (k = 0; k < 2; k++) {
+			if (e->s.dest[k] != 0 && o->rat[e->s.dest[k]] == o->head) {
+				o->rat[e->s.dest[k]] = -1; // the register file holds the newest value now
+			}
+		}
+		o->head = (o->head + 1) % OOO_ROB_SIZE;
+		o->count--;
+		if (!ss_commit(&e->s)) {
+			CURRENT_STATE.PC = e->s.pc + 4;
+			ooo_reset_core(o);
+			NEXT_STATE = CURRENT_STATE;
+			return;
+		}
+	}
+	if (n == 0) {
+		profile_retire(0, 0);
+	}
+
+	/* Writeback: results reach the CDB; a mispredicted branch squashes everything younger */
+	for (i = 0; i < o->count; i++) {
+		idx = (o->head + i) % OOO_ROB_SIZE;
+		if (o->rob[idx].state == OOO_EXECUTING && o->rob[idx].done <= o->now) {
+			ooo_writeback(o, idx);
+		}
+	}
+
+	/* Issue: oldest ready reservation stations first, one load per cycle */
+	for (n = 0, i = 0; i < o->rs_count; ) {
+		e = &o->rob[o->rs[i]];
+		if (n < (int)OOO_WIDTH && e->tag[0] < 0 && e->tag[1] < 0 && ooo_issue(o, o->rs[i], &mem_port)) {
+			memmove(&o->rs[i], &o->rs[i + 1], (o->rs_count - i - 1) * sizeof(o->rs[0]));
+			o->rs_count--;
+			n++;
+		}
+		else {
+			i++;
+		}
+	}
+
+	/* Dispatch: rename from the fetch queue in order */
+	for (n = 0; n < (int)OOO_WIDTH && n < o->fetched; n++) {
+		if (!ooo_dispatch(o, &o->fetch[n], o->fetch_next[n])) {
+			break;
+		}
+	}
+	if (n > 0) {
+		o->refill = FALSE;
+	}
+	else if (o->refill) {
+		PERF_INC(PERF_CONTROL_FLUSH);
+	}
+	memmove(o->fetch, o->fetch + n, (o->fetched - n) * sizeof(o->fetch[0]));
+	memmove(o->fetch_next, o->fetch_next + n, (o->fetched - n) * sizeof(o->fetch_next[0]));
+	o->fetched -= n;
+
+	/* Fetch: follow the predicted path, stopping at a breakpoint */
+	for (n = 0; n < (int)OOO_WIDTH && o->fetched < 2 * (int)OOO_WIDTH; n++) {
+		if (n && BREAK_ACTIVE && break_is_set(CURRENT_STATE.PC)) {
+			break;
+		}
+		if (REUSE_ENABLED) {
+			reuse_access(REUSE_INST, CURRENT_STATE.PC);
+		}
+		ss_decode(&o->fetch[o->fetched], mem_read_32(CURRENT_STATE.PC), CURRENT_STATE.PC);
+		CURRENT_STATE.PC = o->fetch_next[o->fetched] = ooo_predict(&o->fetch[o->fetched]);
+		o->fetched++;
+	}
+	NEXT_STATE = CURRENT_STATE;
+}
+
+/************************************************************/
+/* Print occupancy, stalls and speculation of the backend   */
+/************************************************************/
+void ooo_dump() {
+	double cycles = OOO_CYCLES ? (double)OOO_CYCLES : 1.0;
+
+	printf("-------------------------------------------------------------\n");
+	printf("Out-of-order backend: %s, %u-wide\n", OOO_ENABLED ? "ON" : "OFF", OOO_WIDTH);
+	printf("ROB %u, reservation stations %u, LSQ %u\n", OOO_ROB_SIZE, OOO_RS_SIZE, OOO_LSQ_SIZE);
+	printf("-------------------------------------------------------------\n");
+	printf("cycles\t\t%u\t(%llu advancing)\n", CYCLE_COUNT, (unsigned long long)OOO_CYCLES);
+	printf("instructions\t%u\n", INSTRUCTION_COUNT);
+	printf("IPC\t\t%.3f\n", CYCLE_COUNT ? (double)INSTRUCTION_COUNT / CYCLE_COUNT : 0.0);
+	printf("dispatched\t%llu\n", (unsigned long long)OOO_DISPATCHED);
+	printf("squashed\t%llu\twrong-path instructions\n", (unsigned long long)OOO_SQUASHED);
+	printf("mispredicts\t%llu\tof %llu branches and jumps (%.2f%%)\n", (unsigned long long)OOO_MISPREDICTS,
+		(unsigned long long)OOO_BRANCHES, OOO_BRANCHES ? 100.0 * OOO_MISPREDICTS / OOO_BRANCHES : 0.0);
+	printf("forwarded\t%llu\tloads served by an older store\n", (unsigned long long)OOO_FORWARDED);
+	printf("load blocked\t%llu\tcycles behind an older store\n", (unsigned long long)OOO_LOAD_BLOCKED);
+	printf("ROB occupancy\t%.2f\tmean entries\n", OOO_ROB_OCCUPANCY / cycles);
+	printf("-------------------------------------------------------------\n");
+	printf("[Dispatch stall]\t[Cycles]\n");
+	printf("ROB full\t\t%llu\n", (unsigned long long)OOO_ROB_FULL);
+	printf("RS full\t\t\t%llu\n", (unsigned long long)OOO_RS_FULL);
+	printf("LSQ full\t\t%llu\n", (unsigned long long)OOO_LSQ_FULL);
+	printf("-------------------------------------------------------------\n");
+}
@@ -0,0 +1,338 @@
+/******************************************************************************/
+/* HOST-PARALLEL MULTI-CORE ENGINE                                            */
+/******************************************************************************/
+#include <sched.h>
+
+#define COHERENCE_QUEUE_SIZE 1024 // power of two
+#define PARALLEL_SPINS       256  // busy-wait polls before yielding the host CPU
+
+/* One bus transaction delivered to a core that may hold the line */
+typedef struct Coherence_Msg_Struct {
+	atomic_uint seq;  // slot sequence number of the bounded MPSC queue
+	uint32_t addr;
+	uint8_t op;       // bus_op_t
+	uint8_t from;     // requesting core
+} Coherence_Msg;
+
+/* Per-core inbox: any core enqueues, only the owner dequeues */
+typedef struct Coherence_Queue_Struct {
+	Coherence_Msg slots[COHERENCE_QUEUE_SIZE];
+	atomic_uint head __attribute__((aligned(64)));
+	unsigned tail __attribute__((aligned(64)));
+} Coherence_Queue;
+
+/* What a worker hands the coordinator at the end of a quantum */
+typedef struct Parallel_Core_Struct {
+	uint32_t cycles;        // cycles run before the core halted
+	uint32_t instructions;
+	uint32_t cache_hits, cache_misses;
+	uint64_t counters[NUM_PERF_COUNTERS];
+} __attribute__((aligned(64))) Parallel_Core;
+
+uint32_t PARALLEL_QUANTUM;  // cycles between barriers (0 = serial engine, 1 = lockstep)
+
+Coherence_Queue *COHERENCE_QUEUES;
+Parallel_Core PARALLEL_CORES[MAX_CORES];
+Cache *CORE_L1[MAX_CORES];          // each worker's L1Cache, for snoop responses
+uint8_t *CORE_MESI[MAX_CORES];
+
+/* Central barrier: workers arrive, the coordinator folds statistics, then bumps the generation */
+atomic_int PARALLEL_ARRIVED __attribute__((aligned(64)));
+atomic_uint PARALLEL_GENERATION __attribute__((aligned(64)));
+uint32_t PARALLEL_Q;                // length of the quantum the workers are released into
+int PARALLEL_STOP;
+
+void parallel_relax(int *spins) {
+	if (++*spins < PARALLEL_SPINS) {
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+	}
+	else {
+		*spins = 0;
+		sched_yield();
+	}
+}
+
+/***************************************************************/
+/* Coherence queues                                             */
+/***************************************************************/
+void coherence_apply(Coherence_Msg *msg);
+
+/* Drain this core's inbox; returns the number of messages applied */
+int parallel_drain() {
+	Coherence_Queue *q = &COHERENCE_QUEUES[CURRENT_CORE];
+	Coherence_Msg *slot;
+	int n = 0;
+
+	while (1) {
+		slot = &q->slots[q->tail & (COHERENCE_QUEUE_SIZE - 1)];
+		if (atomic_load_explicit(&slot->seq, memory_order_acquire) != q->tail + 1) {
+			return n;
+		}
+		coherence_apply(slot);
+		atomic_store_explicit(&slot->seq, q->tail + COHERENCE_QUEUE_SIZE, memory_order_release);
+		q->tail++;
+		n++;
+	}
+}
+
+void coherence_post(int to, bus_op_t op, uint32_t addr) {
+	Coherence_Queue *q = &COHERENCE_QUEUES[to];
+	Coherence_Msg *slot;
+	unsigned pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+	int diff, spins = 0;
+
+	while (1) {
+		slot = &q->slots[pos & (COHERENCE_QUEUE_SIZE - 1)];
+		diff = (int)(atomic_load_explicit(&slot->seq, memory_order_acquire) - pos);
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (diff < 0) { // full: keep our own inbox moving so the receiver cannot wait on us
+			parallel_drain();
+			parallel_relax(&spins);
+			pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+		}
+		else {
+			pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+		}
+	}
+	slot->addr = addr;
+	slot->op = op;
+	slot->from = CURRENT_CORE;
+	atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+}
+
+/* Apply a bus transaction from another core to this core's L1, as mesi_snoop() does serially */
+void coherence_apply(Coherence_Msg *msg) {
+	uint32_t index = (msg->addr & 0x000000F0) >> 4;
+	uint32_t tag = (msg->addr & 0xFFFFFF00) >> 8;
+	CacheBlock *block = &L1Cache.blocks[index];
+
+	if (VICTIM_ENTRIES) {
+		victim_snoop(CURRENT_CORE, msg->op, msg->addr);
+	}
+	if (!block->valid || block->tag != tag || MESI_STATE[index] == MESI_I) {
+		return;
+	}
+	if (MESI_STATE[index] == MESI_M) {
+		CORE_STATS[CURRENT_CORE].flushes++;
+	}
+	tags_lock();
+	if (msg->op == BUS_RD) {
+		MESI_STATE[index] = MESI_S;
+	}
+	else {
+		MESI_STATE[index] = MESI_I;
+		block->valid = 0;
+	}
+	tags_unlock();
+	if (msg->op != BUS_RD) {
+		CORE_STATS[CURRENT_CORE].inval_recv++;
+		__atomic_fetch_add(&CORE_STATS[msg->from].inval_sent, 1, __ATOMIC_RELAXED);
+	}
+}
+
+/* mesi_snoop() for a worker thread: the snoop response comes from the other cores' tags,
+   read under TAGS_LOCK; the state change travels through their queues and lands at their
+   next cycle. Posting may wait on a full queue, so it happens after the lock is dropped */
+int parallel_snoop(bus_op_t op, uint32_t addr) {
+	uint32_t index = (addr & 0x000000F0) >> 4;
+	uint32_t tag = (addr & 0xFFFFFF00) >> 8;
+	uint64_t holders = 0;
+	CacheBlock *block;
+	int i;
+
+	pthread_mutex_lock(&TAGS_LOCK);
+	for (i = 0; i < NUM_CORES; i++) {
+		block = &CORE_L1[i]->blocks[index];
+		if (i != CURRENT_CORE && (op != BUS_RD || (block->valid && block->tag == tag && CORE_MESI[i][index] != MESI_I))) {
+			holders |= 1ull << i;
+		}
+	}
+	pthread_mutex_unlock(&TAGS_LOCK);
+	for (i = 0; i < NUM_CORES; i++) {
+		if (holders & (1ull << i)) {
+			coherence_post(i, op, addr);
+		}
+	}
+	return op == BUS_RD && holders != 0;
+}
+
+/***************************************************************/
+/* Worker: one simulated core on one host thread                */
+/***************************************************************/
+void *parallel_worker(void *arg) {
+	Parallel_Core *out;
+	unsigned generation;
+	uint32_t c;
+	int spins;
+
+	CURRENT_CORE = (int)(intptr_t)arg;
+	out = &PARALLEL_CORES[CURRENT_CORE];
+	core_load(&CORES[CURRENT_CORE]);
+	INSTRUCTION_COUNT = 0;
+	cache_hits = 0;
+	cache_misses = 0;
+	memset(PERF_COUNTERS, 0, sizeof(PERF_COUNTERS));
+	PROFILE_PENDING_STALL = 0;
+	CORE_L1[CURRENT_CORE] = &L1Cache;
+	CORE_MESI[CURRENT_CORE] = MESI_STATE;
+
+	while (1) {
+		generation = atomic_load_explicit(&PARALLEL_GENERATION, memory_order_acquire);
+		atomic_fetch_add_explicit(&PARALLEL_ARRIVED, 1, memory_order_acq_rel);
+		spins = 0;
+		while (atomic_load_explicit(&PARALLEL_GENERATION, memory_order_acquire) == generation) {
+			if (parallel_drain() == 0) {
+				parallel_relax(&spins);
+			}
+		}
+		if (PARALLEL_STOP) {
+			break;
+		}
+
+		out->cycles = 0;
+		for (c = 0; c < PARALLEL_Q; c++) {
+			parallel_drain();
+			if (CORES[CURRENT_CORE].halted) {
+				continue;
+			}
+			RUN_FLAG = TRUE;
+			core_cycle();
+			out->cycles++;
+			CORES[CURRENT_CORE].halted = !RUN_FLAG;
+		}
+
+		out->instructions = INSTRUCTION_COUNT;
+		out->cache_hits = cache_hits;
+		out->cache_misses = cache_misses;
+		memcpy(out->counters, PERF_COUNTERS, sizeof(PERF_COUNTERS));
+		CORE_STATS[CURRENT_CORE].cycles += out->cycles;
+		CORE_STATS[CURRENT_CORE].instructions += INSTRUCTION_COUNT;
+		CORE_STATS[CURRENT_CORE].cache_hits += cache_hits;
+		CORE_STATS[CURRENT_CORE].cache_misses += cache_misses;
+		INSTRUCTION_COUNT = 0;
+		cache_hits = 0;
+		cache_misses = 0;
+		memset(PERF_COUNTERS, 0, sizeof(PERF_COUNTERS));
+	}
+	parallel_drain(); // everything posted in the last quantum was posted before the final barrier
+	core_save(&CORES[CURRENT_CORE]);
+	return NULL;
+}
+
+/* Coordinator side of the barrier: wait for every worker */
+void parallel_wait_all() {
+	int spins = 0;
+	while (atomic_load_explicit(&PARALLEL_ARRIVED, memory_order_acquire) < NUM_CORES) {
+		parallel_relax(&spins);
+	}
+	atomic_store_explicit(&PARALLEL_ARRIVED, 0, memory_order_relaxed);
+}
+
+void parallel_release() {
+	atomic_fetch_add_explicit(&PARALLEL_GENERATION, 1, memory_order_release);
+}
+
+/***************************************************************/
+/* TRUE when run()/runAll() should hand the cores to threads.   */
+/* Breakpoints and watchpoints are checked after every cycle,    */
+/* which the workers never stop for, so with any set the cores   */
+/* run serially instead                                          */
+/***************************************************************/
+int parallel_enabled() {
+	if (NUM_CORES < 2 || PARALLEL_QUANTUM == 0) {
+		return FALSE;
+	}
+	if (BREAK_ACTIVE) {
+		printf("Breakpoints or watchpoints are set: running the cores serially\n");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/***************************************************************/
+/* Run every core on its own thread for max_cycles (0 = until   */
+/* all halt), meeting at a barrier every PARALLEL_QUANTUM cycles */
+/***************************************************************/
+void parallel_run(uint32_t max_cycles) {
+	pthread_t threads[MAX_CORES];
+	uint32_t done = 0, advance, stage_sample = HOST_STAGE_SAMPLE;
+	int i, k, running = TRUE;
+
+	core_save(&CORES[CURRENT_CORE]);
+	HOST_STAGE_SAMPLE = 0; // stage timing is per-thread unsafe
+	if (COHERENCE_QUEUES == NULL) {
+		COHERENCE_QUEUES = aligned_alloc(64, MAX_CORES * sizeof(Coherence_Queue));
+	}
+	for (i = 0; i < NUM_CORES; i++) {
+		for (k = 0; k < COHERENCE_QUEUE_SIZE; k++) {
+			atomic_init(&COHERENCE_QUEUES[i].slots[k].seq, k);
+		}
+		atomic_init(&COHERENCE_QUEUES[i].head, 0);
+		COHERENCE_QUEUES[i].tail = 0;
+	}
+	atomic_store(&PARALLEL_ARRIVED, 0);
+	PARALLEL_STOP = FALSE;
+	PARALLEL_ACTIVE = TRUE;
+
+	for (i = 0; i < NUM_CORES; i++) {
+		if (pthread_create(&threads[i], NULL, parallel_worker, (void *)(intptr_t)i) != 0) {
+			printf("Error: Can't start thread for core %d\n", i);
+			exit(-1);
+		}
+	}
+	parallel_wait_all(); // every worker has published its L1
+
+	while (1) {
+		for (i = 0, running = FALSE; i < NUM_CORES; i++) {
+			running |= !CORES[i].halted;
+		}
+		if (!running || (max_cycles && done >= max_cycles)) {
+			break;
+		}
+		PARALLEL_Q = PARALLEL_QUANTUM;
+		if (max_cycles && max_cycles - done < PARALLEL_Q) {
+			PARALLEL_Q = max_cycles - done;
+		}
+		parallel_release();
+		parallel_wait_all();
+
+		/* Fold the quantum into the totals; a quantum where everyone halted ends at the last halt */
+		advance = 0;
+		for (i = 0; i < NUM_CORES; i++) {
+			INSTRUCTION_COUNT += PARALLEL_CORES[i].instructions;
+			cache_hits += PARALLEL_CORES[i].cache_hits;
+			cache_misses += PARALLEL_CORES[i].cache_misses;
+			for (k = 0; k < NUM_PERF_COUNTERS; k++) {
+				PERF_COUNTERS[k] += PARALLEL_CORES[i].counters[k];
+			}
+			if (PARALLEL_CORES[i].cycles > advance) {
+				advance = PARALLEL_CORES[i].cycles;
+			}
+		}
+		for (i = 0, running = FALSE; i < NUM_CORES; i++) {
+			running |= !CORES[i].halted;
+		}
+		if (running) {
+			advance = PARALLEL_Q;
+		}
+		CYCLE_COUNT += advance;
+		done += advance;
+		TELEMETRY_TICK();
+	}
+
+	PARALLEL_STOP = TRUE;
+	parallel_release();
+	for (i = 0; i < NUM_CORES; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	PARALLEL_ACTIVE = FALSE;
+	HOST_STAGE_SAMPLE = stage_sample;
+	core_load(&CORES[CURRENT_CORE]);
+	RUN_FLAG = running;
+}
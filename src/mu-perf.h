@@ -0,0 +1,130 @@
+/******************************************************************************/
+/* PERFORMANCE COUNTERS                                                       */
+/******************************************************************************/
+/* Issue width of the backend in use, for the CPI stack (mu-superscalar.h, mu-ooo.h) */
+extern uint32_t ISSUE_WIDTH, OOO_WIDTH;
+extern int OOO_ENABLED, NUM_CORES;
+
+typedef enum {
+	/* retired instructions, by class */
+	PERF_RETIRED_ALU,
+	PERF_RETIRED_LOAD,
+	PERF_RETIRED_STORE,
+	PERF_RETIRED_BRANCH,
+	PERF_RETIRED_JUMP,
+	PERF_RETIRED_MULDIV,
+	PERF_RETIRED_HILO,
+	PERF_RETIRED_SYSCALL,
+	/* lost fetch slots, by cause */
+	PERF_RAW_STALL,       // RAW hazard bubble, forwarding off
+	PERF_RAW_STALL_FWD,   // RAW hazard bubble, forwarding on
+	PERF_LOAD_USE,        // load-use bubble inserted in ID
+	PERF_CONTROL_FLUSH,   // wrong-path slots squashed behind a taken branch/jump
+	PERF_CACHE_MISS_STALL,// pipeline frozen while a cache line fills
+	PERF_MSHR_STALL,      // pipeline frozen on a register an outstanding miss will write
+	PERF_FU_STALL,        // pipeline frozen on a busy unpipelined multiplier/divider
+	PERF_HILO_STALL,      // HI/LO access frozen until a MULT/DIV in flight writes them
+	NUM_PERF_COUNTERS
+} perf_counter_t;
+
+const char *PERF_COUNTER_NAMES[NUM_PERF_COUNTERS] = {
+	"retired.alu",
+	"retired.load",
+	"retired.store",
+	"retired.branch",
+	"retired.jump",
+	"retired.muldiv",
+	"retired.hilo",
+	"retired.syscall",
+	"stall.raw",
+	"stall.raw_fwd",
+	"stall.load_use",
+	"stall.control_flush",
+	"stall.cache_miss",
+	"stall.mshr",
+	"stall.funit",
+	"stall.hilo"
+};
+
+CORE_LOCAL uint64_t PERF_COUNTERS[NUM_PERF_COUNTERS];
+
+#define PERF_INC(c) (PERF_COUNTERS[(c)]++)
+
+// No counter: a slot lost to pipeline fill/drain or a serializing syscall, left to "other"
+#define PERF_NO_CAUSE NUM_PERF_COUNTERS
+
+void perf_reset() {
+	memset(PERF_COUNTERS, 0, sizeof(PERF_COUNTERS));
+	MEM_STALL_CYCLES = 0;
+}
+
+// Called from WB() with the instruction leaving the pipeline
+void perf_retire(uint32_t ir) {
+	uint32_t opcode = (ir & 0xFC000000) >> 26;
+	uint32_t function = ir & 0x0000003F;
+
+	if (ir == 0 || ir == 0x00000001) { // empty slot or bubble
+		return;
+	}
+	if (opcode == 0x00) {
+		switch (function) {
+			case 0x08: case 0x09: PERF_INC(PERF_RETIRED_JUMP); break;          // JR, JALR
+			case 0x0C: PERF_INC(PERF_RETIRED_SYSCALL); break;
+			case 0x10: case 0x11: case 0x12: case 0x13: PERF_INC(PERF_RETIRED_HILO); break;
+			case 0x18: case 0x19: case 0x1A: case 0x1B: PERF_INC(PERF_RETIRED_MULDIV); break;
+			default: PERF_INC(PERF_RETIRED_ALU); break;
+		}
+		return;
+	}
+	switch (opcode) {
+		case 0x01: case 0x04: case 0x05: case 0x06: case 0x07: PERF_INC(PERF_RETIRED_BRANCH); break;
+		case 0x02: case 0x03: PERF_INC(PERF_RETIRED_JUMP); break;
+		case 0x20: case 0x21: case 0x23: PERF_INC(PERF_RETIRED_LOAD); break;
+		case 0x28: case 0x29: case 0x2B: PERF_INC(PERF_RETIRED_STORE); break;
+		default: PERF_INC(PERF_RETIRED_ALU); break;
+	}
+}
+
+/***************************************************************/
+/* Print all counters and the CPI stack                        */
+/***************************************************************/
+void perf_dump() {
+	int i;
+	double stalls = 0, stall;
+	double cycles = CYCLE_COUNT ? (double)CYCLE_COUNT : 1.0;
+	double insts = INSTRUCTION_COUNT ? (double)INSTRUCTION_COUNT : 1.0;
+	double width = OOO_ENABLED ? OOO_WIDTH : ISSUE_WIDTH;
+	double base = INSTRUCTION_COUNT / width / NUM_CORES, other;
+	uint32_t accesses = cache_hits + cache_misses;
+
+	printf("-------------------------------------\n");
+	printf("Performance Counters\n");
+	printf("-------------------------------------\n");
+	printf("cycles\t\t\t: %u\n", CYCLE_COUNT);
+	printf("instructions\t\t: %u\n", INSTRUCTION_COUNT);
+	for (i = 0; i < NUM_PERF_COUNTERS; i++) {
+		printf("%-24s: %llu\n", PERF_COUNTER_NAMES[i], (unsigned long long)PERF_COUNTERS[i]);
+	}
+	printf("cache.hits\t\t: %u\n", cache_hits);
+	printf("cache.misses\t\t: %u\n", cache_misses);
+	printf("cache.hit_rate\t\t: %.2f%%\n", accesses ? 100.0 * cache_hits / accesses : 0.0);
+	printf("-------------------------------------\n");
+	// In cycles of one core, averaged over all of them since the counters sum every core: base
+	// is the time the retired instructions need at full issue width, and each stall counts an
+	// issue cycle (or, in the scalar pipeline, an issued slot) that retired nothing, so base
+	// and the stalls never add up to more than the run
+	printf("CPI Stack (issue width %g)\t[Cycles]\t[CPI]\t[%%]\n", width);
+	printf("-------------------------------------\n");
+	printf("%-24s%.1f\t\t%.3f\t%5.1f\n", "base", base, base / insts, 100.0 * base / cycles);
+	for (i = PERF_RAW_STALL; i < NUM_PERF_COUNTERS; i++) {
+		stall = (double)PERF_COUNTERS[i] / NUM_CORES;
+		stalls += stall;
+		printf("%-24s%.1f\t\t%.3f\t%5.1f\n", PERF_COUNTER_NAMES[i], stall, stall / insts, 100.0 * stall / cycles);
+	}
+	// Whatever is left is fill/drain, partly filled issue cycles and slots no cause above covers
+	other = CYCLE_COUNT - base - stalls;
+	other = other > 0 ? other : 0;
+	printf("%-24s%.1f\t\t%.3f\t%5.1f\n", "other", other, other / insts, 100.0 * other / cycles);
+	printf("%-24s%u\t\t%.3f\n", "total", CYCLE_COUNT, CYCLE_COUNT / insts);
+	printf("-------------------------------------\n");
+}
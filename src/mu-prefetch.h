@@ -0,0 +1,257 @@
+/******************************************************************************/
+/* DATA PREFETCHERS                                                           */
+/******************************************************************************/
+#define RPT_SIZE     64 // stride prefetcher reference prediction table entries
+#define NUM_STREAMS  8  // stream prefetcher tracked streams
+#define LINE_BYTES   (WORD_PER_BLOCK * 4)
+
+typedef enum {
+	PREFETCH_NONE,
+	PREFETCH_NEXT_LINE,
+	PREFETCH_STRIDE,
+	PREFETCH_STREAM,
+	NUM_PREFETCHERS
+} prefetcher_t;
+
+const char *PREFETCHER_NAMES[NUM_PREFETCHERS] = { "none", "next-line", "stride", "stream" };
+
+/* Reference prediction table entry, indexed by load/store PC */
+typedef struct RPT_Entry_Struct {
+	uint32_t pc;
+	uint32_t last_addr;
+	int32_t stride;
+	int conf;       // 0..3, prefetch at 2 and above
+} RPT_Entry;
+
+typedef struct Stream_Struct {
+	uint32_t line;  // last line address seen on the stream
+	int dir;        // +1 / -1 once two adjacent lines confirm it, 0 before
+	uint32_t lru;
+} Stream;
+
+/* A line brought in by a prefetch and not yet used by a demand access */
+typedef struct Prefetched_Line_Struct {
+	int valid;
+	uint32_t tag;
+	uint32_t ready; // CYCLE_COUNT when the fill completes
+} Prefetched_Line;
+
+/* One core's prefetcher state */
+typedef struct Prefetch_State_Struct {
+	RPT_Entry rpt[RPT_SIZE];
+	Stream streams[NUM_STREAMS];
+	uint32_t stream_clock;
+	Prefetched_Line lines[NUM_CACHE_BLOCKS];
+} Prefetch_State;
+
+prefetcher_t PREFETCHER;
+uint32_t PREFETCH_DEGREE = 1;  // lines issued per trigger
+Prefetch_State PREFETCH_STATE[MAX_CORES]; // indexed by CURRENT_CORE
+uint32_t MEM_BUS_FREE;         // cycle at which the memory bus finishes its queued fills
+pthread_mutex_t MEM_BUS_LOCK = PTHREAD_MUTEX_INITIALIZER; // cores on host threads share the bus
+
+/* Statistics, shared by all cores */
+uint64_t PF_ISSUED;     // prefetch fills sent to memory
+uint64_t PF_USEFUL;     // prefetched lines later touched by a demand access
+uint64_t PF_LATE;       // ... that were still in flight at that point
+uint64_t PF_LATE_CYCLES;
+uint64_t PF_UNUSED;     // prefetched lines evicted before any demand access
+uint64_t PF_BUS_WAIT;   // demand-miss cycles spent queued behind prefetch fills
+
+void prefetch_reset() {
+	memset(PREFETCH_STATE, 0, sizeof(PREFETCH_STATE));
+	MEM_BUS_FREE = 0;
+	PF_ISSUED = PF_USEFUL = PF_LATE = PF_LATE_CYCLES = PF_UNUSED = PF_BUS_WAIT = 0;
+}
+
+/* Reserve the memory bus for one line fill; returns the cycle the fill completes, and in *wait */
+/* (when not NULL) the cycles it queues behind fills already on the bus                         */
+uint32_t prefetch_bus_fill(uint32_t *wait) {
+	uint32_t start, done;
+
+	if (PARALLEL_ACTIVE) {
+		pthread_mutex_lock(&MEM_BUS_LOCK);
+	}
+	start = MEM_BUS_FREE > CYCLE_COUNT ? MEM_BUS_FREE : CYCLE_COUNT;
+	MEM_BUS_FREE = done = start + CACHE_MISS_PENALTY;
+	if (PARALLEL_ACTIVE) {
+		pthread_mutex_unlock(&MEM_BUS_LOCK);
+	}
+	if (wait) {
+		*wait = start - CYCLE_COUNT;
+	}
+	return done;
+}
+
+/* Fill the line holding addr unless it is already cached */
+void prefetch_line(uint32_t addr) {
+	uint32_t index = (addr & 0x000000F0) >> 4;
+	uint32_t tag = (addr & 0xFFFFFF00) >> 8;
+	Prefetched_Line *pl = &PREFETCH_STATE[CURRENT_CORE].lines[index];
+	int i, shared;
+
+	if (addr < MEM_DATA_BEGIN || (L1Cache.blocks[index].valid && L1Cache.blocks[index].tag == tag)) {
+		return;
+	}
+	if (pl->valid) {
+		SHARED_INC(PF_UNUSED, 1);
+	}
+	if (VICTIM_ENTRIES) {
+		victim_evict(index);
+	}
+	for (i = 0; i < WORD_PER_BLOCK; i++) {
+		L1Cache.blocks[index].words[i] = mem_read_32((addr & 0xFFFFFFF0) + (i * 4));
+	}
+	tags_lock();
+	L1Cache.blocks[index].tag = tag;
+	L1Cache.blocks[index].valid = 1;
+	tags_unlock();
+	if (NUM_CORES > 1) {
+		shared = mesi_snoop(BUS_RD, addr);
+		tags_lock();
+		MESI_STATE[index] = shared ? MESI_S : MESI_E;
+		tags_unlock();
+	}
+	pl->valid = TRUE;
+	pl->tag = tag;
+	pl->ready = DRAM_ENABLED ? CYCLE_COUNT + mem_fill_latency(addr, CYCLE_COUNT) : prefetch_bus_fill(NULL);
+	SHARED_INC(PF_ISSUED, 1);
+}
+
+void prefetch_stride(uint32_t pc, uint32_t addr) {
+	RPT_Entry *e = &PREFETCH_STATE[CURRENT_CORE].rpt[(pc >> 2) % RPT_SIZE];
+	int32_t stride;
+	uint32_t i;
+
+	if (e->pc != pc) {
+		e->pc = pc;
+		e->last_addr = addr;
+		e->stride = 0;
+		e->conf = 0;
+		return;
+	}
+	stride = (int32_t)(addr - e->last_addr);
+	if (stride == e->stride) {
+		e->conf += e->conf < 3;
+	}
+	else {
+		e->conf -= e->conf > 0;
+		if (e->conf < 2) {
+			e->stride = stride;
+		}
+	}
+	e->last_addr = addr;
+	if (e->conf >= 2 && e->stride != 0) {
+		for (i = 1; i <= PREFETCH_DEGREE; i++) {
+			prefetch_line(addr + e->stride * i);
+		}
+	}
+}
+
+void prefetch_stream(uint32_t addr) {
+	Prefetch_State *pf = &PREFETCH_STATE[CURRENT_CORE];
+	uint32_t line = addr / LINE_BYTES, i;
+	Stream *s, *victim = &pf->streams[0];
+	int k, delta;
+
+	pf->stream_clock++;
+	for (k = 0; k < NUM_STREAMS; k++) {
+		s = &pf->streams[k];
+		delta = (int)(line - s->line);
+		if ((s->dir != 0 && delta == s->dir) || (s->dir == 0 && (delta == 1 || delta == -1))) {
+			s->dir = delta;
+			s->line = line;
+			s->lru = pf->stream_clock;
+			for (i = 1; i <= PREFETCH_DEGREE; i++) {
+				prefetch_line((line + s->dir * i) * LINE_BYTES);
+			}
+			return;
+		}
+		if (s->lru < victim->lru) {
+			victim = s;
+		}
+	}
+	victim->line = line;
+	victim->dir = 0;
+	victim->lru = pf->stream_clock;
+}
+
+/***************************************************************/
+/* Called from MEM() after every demand load or store          */
+/***************************************************************/
+void prefetch_access(uint32_t opcode, uint32_t pc, uint32_t addr, int missed) {
+	uint32_t index = (addr & 0x000000F0) >> 4;
+	uint32_t tag = (addr & 0xFFFFFF00) >> 8;
+	Prefetched_Line *pl = &PREFETCH_STATE[CURRENT_CORE].lines[index];
+	uint32_t wait;
+	int trigger = missed, i;
+
+	switch (opcode) {
+		case 0x20: case 0x21: case 0x23: case 0x2B: break; // LB, LH, LW, SW go through the L1
+		default: return;
+	}
+
+	if (pl->valid) {
+		if (pl->tag != tag) {       // the demand fill evicted it
+			SHARED_INC(PF_UNUSED, 1);
+		}
+		else if (!missed) {
+			SHARED_INC(PF_USEFUL, 1);
+			if (pl->ready > CYCLE_COUNT) {
+				SHARED_INC(PF_LATE, 1);
+				SHARED_INC(PF_LATE_CYCLES, pl->ready - CYCLE_COUNT);
+				MEM_STALL_CYCLES += pl->ready - CYCLE_COUNT;
+			}
+			trigger = TRUE; // keep running ahead of a stream that prefetching turned into hits
+		}
+		pl->valid = FALSE;
+	}
+	if (missed && !DRAM_ENABLED) { // the demand fill shares the bus with prefetches in flight; the DRAM model queues them itself
+		prefetch_bus_fill(&wait);
+		if (wait > 0) {
+			SHARED_INC(PF_BUS_WAIT, wait);
+			MEM_STALL_CYCLES += wait;
+		}
+	}
+
+	switch (PREFETCHER) {
+		case PREFETCH_NEXT_LINE:
+			if (trigger) {
+				for (i = 1; i <= PREFETCH_DEGREE; i++) {
+					prefetch_line((addr & 0xFFFFFFF0) + i * LINE_BYTES);
+				}
+			}
+			break;
+		case PREFETCH_STRIDE:
+			prefetch_stride(pc, addr);
+			break;
+		case PREFETCH_STREAM:
+			if (trigger) {
+				prefetch_stream(addr);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+/************************************************************/
+/* Print prefetch accuracy, coverage and lateness           */
+/************************************************************/
+void prefetch_dump() {
+	uint64_t demand_misses = cache_misses;
+
+	printf("-------------------------------------------------------------\n");
+	printf("Prefetcher: %s, degree %u\n", PREFETCHER_NAMES[PREFETCHER], PREFETCH_DEGREE);
+	printf("-------------------------------------------------------------\n");
+	printf("issued\t\t%llu\n", (unsigned long long)PF_ISSUED);
+	printf("useful\t\t%llu\n", (unsigned long long)PF_USEFUL);
+	printf("late\t\t%llu\t(%llu cycles)\n", (unsigned long long)PF_LATE, (unsigned long long)PF_LATE_CYCLES);
+	printf("unused\t\t%llu\n", (unsigned long long)PF_UNUSED);
+	printf("bus wait\t%llu\tcycles\n", (unsigned long long)PF_BUS_WAIT);
+	printf("accuracy\t%.2f%%\tuseful / issued\n", PF_ISSUED ? 100.0 * PF_USEFUL / PF_ISSUED : 0.0);
+	printf("coverage\t%.2f%%\tuseful / (useful + demand misses)\n",
+		PF_USEFUL + demand_misses ? 100.0 * PF_USEFUL / (PF_USEFUL + demand_misses) : 0.0);
+	printf("lateness\t%.2f%%\tlate / useful\n", PF_USEFUL ? 100.0 * PF_LATE / PF_USEFUL : 0.0);
+	printf("-------------------------------------------------------------\n");
+}
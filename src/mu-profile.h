@@ -0,0 +1,172 @@
+/******************************************************************************/
+/* PER-PC HOTSPOT PROFILE                                                     */
+/******************************************************************************/
+typedef struct Profile_Entry_Struct {
+	uint64_t exec;   // times the instruction retired in WB
+	uint64_t stall;  // empty WB cycles charged to the next instruction that retired
+	uint64_t dmiss;  // D-cache misses taken in MEM
+} Profile_Entry;
+
+/* Flat table over the loaded text segment, indexed by (PC - MEM_TEXT_BEGIN) >> 2 */
+Profile_Entry *PROFILE;
+uint32_t PROFILE_SIZE;
+CORE_LOCAL uint64_t PROFILE_PENDING_STALL; // empty WB cycles since the last retirement
+
+#define PROFILE_INDEX(pc) (((pc) - MEM_TEXT_BEGIN) >> 2)
+
+/* (Re)allocate the table for the program currently in memory */
+void profile_reset() {
+	free(PROFILE);
+	PROFILE_SIZE = PROGRAM_SIZE;
+	PROFILE = calloc(PROFILE_SIZE ? PROFILE_SIZE : 1, sizeof(Profile_Entry));
+	PROFILE_PENDING_STALL = 0;
+}
+
+// Called from WB() with the address of the instruction leaving the pipeline
+void profile_retire(uint32_t ir, uint32_t addr) {
+	uint32_t index = PROFILE_INDEX(addr);
+	if (ir == 0 || ir == 0x00000001) { // empty slot or bubble
+		PROFILE_PENDING_STALL++;
+		return;
+	}
+	if (index < PROFILE_SIZE) {
+		SHARED_INC(PROFILE[index].exec, 1);
+		SHARED_INC(PROFILE[index].stall, PROFILE_PENDING_STALL);
+	}
+	PROFILE_PENDING_STALL = 0;
+}
+
+// Called from MEM() when the access at addr missed in L1
+void profile_dmiss(uint32_t addr) {
+	uint32_t index = PROFILE_INDEX(addr);
+	if (index < PROFILE_SIZE) {
+		SHARED_INC(PROFILE[index].dmiss, 1);
+	}
+}
+
+/* Static branch/jump target of the instruction at addr, or 0 when there is none.
+   Branch offsets are relative to the branch itself, as in EX(). */
+uint32_t profile_branch_target(uint32_t addr) {
+	uint32_t instruction = mem_read_32(addr);
+	uint32_t opcode = (instruction & 0xFC000000) >> 26;
+	uint32_t immediate = instruction & 0x0000FFFF;
+	uint32_t offset = ( (immediate & 0x8000) > 0 ? (immediate | 0xFFFF0000) : immediate ) << 2;
+
+	switch(opcode){
+		case 0x01: case 0x04: case 0x05: case 0x06: case 0x07:
+			return addr + offset;
+		case 0x02: case 0x03:
+			return (addr & 0xF0000000) | ((instruction & 0x03FFFFFF) << 2);
+		default:
+			return 0;
+	}
+}
+
+/* True for any instruction that ends a basic block */
+int profile_ends_block(uint32_t addr) {
+	uint32_t instruction = mem_read_32(addr);
+	uint32_t opcode = (instruction & 0xFC000000) >> 26;
+	uint32_t function = instruction & 0x0000003F;
+
+	if (opcode == 0x00) {
+		return function == 0x08 || function == 0x09 || function == 0x0C; // JR, JALR, SYSCALL
+	}
+	return opcode == 0x01 || (opcode >= 0x02 && opcode <= 0x07);
+}
+
+/************************************************************/
+/* Print the top-n PCs and the basic blocks they belong to  */
+/************************************************************/
+void profile_dump(int n) {
+	uint32_t i, j, target, addr, block;
+	uint32_t *order, *leader;
+	uint8_t *is_leader, *shown;
+	uint64_t total = 0, cycles_i, cycles_j, tmp;
+
+	if (PROFILE_SIZE == 0) {
+		printf("No program loaded.\n");
+		return;
+	}
+	order = malloc(PROFILE_SIZE * sizeof(uint32_t));
+	leader = malloc(PROFILE_SIZE * sizeof(uint32_t));
+	is_leader = calloc(PROFILE_SIZE, 1);
+	shown = calloc(PROFILE_SIZE, 1);
+
+	/* Mark block leaders: the entry point, branch targets and fall-throughs */
+	is_leader[0] = 1;
+	for (i = 0; i < PROFILE_SIZE; i++) {
+		addr = MEM_TEXT_BEGIN + (i << 2);
+		target = profile_branch_target(addr);
+		if (target >= MEM_TEXT_BEGIN && PROFILE_INDEX(target) < PROFILE_SIZE) {
+			is_leader[PROFILE_INDEX(target)] = 1;
+		}
+		if (profile_ends_block(addr) && i + 1 < PROFILE_SIZE) {
+			is_leader[i + 1] = 1;
+		}
+	}
+	for (i = 0; i < PROFILE_SIZE; i++) {
+		leader[i] = is_leader[i] ? i : leader[i - 1];
+		order[i] = i;
+		total += PROFILE[i].exec + PROFILE[i].stall;
+	}
+
+	/* Insertion sort by cycles (retirements + charged stalls), hottest first */
+	for (i = 1; i < PROFILE_SIZE; i++) {
+		tmp = order[i];
+		cycles_i = PROFILE[tmp].exec + PROFILE[tmp].stall;
+		for (j = i; j > 0; j--) {
+			cycles_j = PROFILE[order[j - 1]].exec + PROFILE[order[j - 1]].stall;
+			if (cycles_j >= cycles_i) {
+				break;
+			}
+			order[j] = order[j - 1];
+		}
+		order[j] = tmp;
+	}
+	if (n <= 0 || (uint32_t)n > PROFILE_SIZE) {
+		n = PROFILE_SIZE;
+	}
+
+	printf("-------------------------------------------------------------\n");
+	printf("Hotspot profile: top %d PCs by cycles\n", n);
+	printf("-------------------------------------------------------------\n");
+	printf("[PC]\t\t[Exec]\t[Stall]\t[DMiss]\t[%%Cyc]\t[Instruction]\n");
+	for (i = 0; i < n; i++) {
+		j = order[i];
+		printf("0x%08x\t%llu\t%llu\t%llu\t%5.1f\t", MEM_TEXT_BEGIN + (j << 2),
+			(unsigned long long)PROFILE[j].exec, (unsigned long long)PROFILE[j].stall,
+			(unsigned long long)PROFILE[j].dmiss,
+			total ? 100.0 * (PROFILE[j].exec + PROFILE[j].stall) / total : 0.0);
+		print_instruction(MEM_TEXT_BEGIN + (j << 2));
+	}
+
+	/* Annotated disassembly of every block holding a top-n PC, hottest block first */
+	printf("-------------------------------------------------------------\n");
+	printf("Basic blocks\n");
+	printf("-------------------------------------------------------------\n");
+	for (i = 0; i < n; i++) {
+		block = leader[order[i]];
+		if (shown[block]) {
+			continue;
+		}
+		shown[block] = 1;
+		tmp = 0;
+		for (j = block; j < PROFILE_SIZE && leader[j] == block; j++) {
+			tmp += PROFILE[j].exec + PROFILE[j].stall;
+		}
+		printf("block 0x%08x-0x%08x\t%llu cycles (%.1f%%)\n", MEM_TEXT_BEGIN + (block << 2),
+			MEM_TEXT_BEGIN + ((j - 1) << 2), (unsigned long long)tmp, total ? 100.0 * tmp / total : 0.0);
+		for (j = block; j < PROFILE_SIZE && leader[j] == block; j++) {
+			printf("  0x%08x\t%llu\t%llu\t%llu\t", MEM_TEXT_BEGIN + (j << 2),
+				(unsigned long long)PROFILE[j].exec, (unsigned long long)PROFILE[j].stall,
+				(unsigned long long)PROFILE[j].dmiss);
+			print_instruction(MEM_TEXT_BEGIN + (j << 2));
+		}
+	}
+	printf("-------------------------------------------------------------\n");
+
+	free(order);
+	free(leader);
+	free(is_leader);
+	free(shown);
+}
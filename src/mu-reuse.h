@@ -0,0 +1,348 @@
+/******************************************************************************/
+/* REUSE-DISTANCE AND WORKING-SET ANALYSIS OF THE REFERENCE STREAM            */
+/******************************************************************************/
+#define REUSE_LINE_SHIFT     4           // 16-byte lines, as the L1
+#define REUSE_BUCKETS        33          // distance 0, 1, 2-3, 4-7, ... 2^31-(2^32-1)
+#define REUSE_COLD           REUSE_BUCKETS // first touch of a line
+#define REUSE_EMPTY          0xFFFFFFFF
+#define REUSE_DEFAULT_WINDOW 1000        // cycles per working-set window
+
+typedef enum {
+	REUSE_INST,     // IF fetch addresses
+	REUSE_DATA,     // MEM load/store addresses
+	NUM_REUSE_STREAMS
+} reuse_stream_t;
+
+typedef enum {
+	REUSE_TEXT,
+	REUSE_STATIC,   // .data, below the sbrk heap
+	REUSE_HEAP,
+	REUSE_STACK,
+	REUSE_KERNEL,
+	NUM_REUSE_REGIONS
+} reuse_region_t;
+
+const char *REUSE_STREAM_NAMES[NUM_REUSE_STREAMS] = { "inst", "data" };
+const char *REUSE_REGION_NAMES[NUM_REUSE_REGIONS] = { "text", "data", "heap", "stack", "kernel" };
+
+/* Hash slot for one line seen in a stream */
+typedef struct Reuse_Line_Struct {
+	uint32_t line;      // address >> REUSE_LINE_SHIFT, REUSE_EMPTY when free
+	uint32_t last;      // time of its latest access: its bit in the Fenwick tree
+	uint32_t window;    // 1 + working-set window it was last counted in
+} Reuse_Line;
+
+/***************************************************************/
+/* One reference stream. Every access gets the next time; the  */
+/* Fenwick tree holds a 1 at the latest access of each line, so */
+/* the distinct lines touched since a line's previous access    */
+/* are one range sum: O(log n) per reference                    */
+/***************************************************************/
+typedef struct Reuse_Stream_Struct {
+	Reuse_Line *lines;          // open addressing, capacity a power of two
+	uint32_t capacity, count;
+	uint32_t *tree;             // 1-based Fenwick tree over times [0, size)
+	uint32_t *owner;            // slot of the line whose latest access is at each time
+	uint32_t size, now;
+	uint64_t hist[REUSE_BUCKETS + 1];
+	uint32_t window_lines;      // distinct lines in the open window
+	uint32_t ws_peak;
+	uint64_t ws_sum;            // distinct lines summed over closed windows
+} Reuse_Stream;
+
+int REUSE_ENABLED;
+uint32_t REUSE_WINDOW = REUSE_DEFAULT_WINDOW;
+Reuse_Stream REUSE[NUM_REUSE_STREAMS];
+uint32_t REUSE_OPEN_WINDOW;         // CYCLE_COUNT / REUSE_WINDOW of the window being counted
+uint64_t REUSE_CLOSED_WINDOWS;
+uint64_t REUSE_FOOTPRINT[NUM_REUSE_REGIONS];    // distinct lines, both streams
+uint64_t REUSE_REFS[NUM_REUSE_REGIONS];
+pthread_mutex_t REUSE_LOCK = PTHREAD_MUTEX_INITIALIZER; // cores on host threads share the streams
+
+void reuse_reset() {
+	int s;
+
+	for (s = 0; s < NUM_REUSE_STREAMS; s++) {
+		free(REUSE[s].lines);
+		free(REUSE[s].tree);
+		free(REUSE[s].owner);
+	}
+	memset(REUSE, 0, sizeof(REUSE));
+	REUSE_OPEN_WINDOW = 0;
+	REUSE_CLOSED_WINDOWS = 0;
+	memset(REUSE_FOOTPRINT, 0, sizeof(REUSE_FOOTPRINT));
+	memset(REUSE_REFS, 0, sizeof(REUSE_REFS));
+}
+
+/* set reuse / reuse_window */
+void reuse_set(const char *name, int value) {
+	if (strcmp(name, "reuse") == 0) {
+		REUSE_ENABLED = value != 0;
+	}
+	else if (strcmp(name, "reuse_window") == 0) {
+		if (value < 1) {
+			printf("reuse_window must be at least 1 cycle\n");
+			return;
+		}
+		REUSE_WINDOW = value;
+	}
+	else {
+		printf("Unknown reuse parameter %s\n", name);
+		return;
+	}
+	reuse_reset();
+	REUSE_ENABLED == 0 ? printf("Reuse-distance analysis OFF\n") : printf("Reuse-distance analysis ON: working set every %u cycles\n", REUSE_WINDOW);
+}
+
+reuse_region_t reuse_region(uint32_t addr) {
+	if (addr >= MEM_TEXT_BEGIN && addr <= MEM_TEXT_END) {
+		return REUSE_TEXT;
+	}
+	if (addr >= MEM_DATA_BEGIN && addr < SYSCALL_HEAP_BEGIN) {
+		return REUSE_STATIC;
+	}
+	if (addr >= SYSCALL_HEAP_BEGIN && addr < SYSCALL_HEAP_END) {
+		return REUSE_HEAP;
+	}
+	if (addr >= SYSCALL_HEAP_END && addr <= MEM_DATA_END) {
+		return REUSE_STACK;
+	}
+	return REUSE_KERNEL;
+}
+
+/* Sum of the tree over times [0, t) */
+uint32_t reuse_prefix(Reuse_Stream *r, uint32_t t) {
+	uint32_t sum = 0;
+
+	for (; t > 0; t -= t & -t) {
+		sum += r->tree[t];
+	}
+	return sum;
+}
+
+void reuse_add(Reuse_Stream *r, uint32_t t, int delta) {
+	for (t++; t <= r->size; t += t & -t) {
+		r->tree[t] += delta;
+	}
+}
+
+/* Slot of line, or the free slot it would take */
+uint32_t reuse_slot(Reuse_Stream *r, uint32_t line) {
+	uint32_t h = line * 0x9E3779B1u;
+	uint32_t i = (h ^ (h >> 16)) & (r->capacity - 1);
+
+	while (r->lines[i].line != REUSE_EMPTY && r->lines[i].line != line) {
+		i = (i + 1) & (r->capacity - 1);
+	}
+	return i;
+}
+
+/***************************************************************/
+/* Renumber the live lines' times to 0..count-1 in access      */
+/* order and rebuild the tree, doubling it when over half full. */
+/* Called when time runs off its end, so amortized O(log n)     */
+/***************************************************************/
+void reuse_compact(Reuse_Stream *r) {
+	uint32_t t, n = 0;
+
+	for (t = 0; t < r->now; t++) {
+		if (r->owner[t] != REUSE_EMPTY) {
+			r->lines[r->owner[t]].last = n;
+			r->owner[n++] = r->owner[t];
+		}
+	}
+	if (n * 2 > r->size) {
+		r->size *= 2;
+		r->tree = realloc(r->tree, (r->size + 1) * sizeof(uint32_t));
+		r->owner = realloc(r->owner, r->size * sizeof(uint32_t));
+	}
+	memset(r->tree, 0, (r->size + 1) * sizeof(uint32_t));
+	for (t = 0; t < r->size; t++) {
+		if (t >= n) {
+			r->owner[t] = REUSE_EMPTY;
+		}
+		else {
+			reuse_add(r, t, 1);
+		}
+	}
+	r->now = n;
+}
+
+/* Double the hash table; slots move, so owner[] is rebuilt */
+void reuse_grow(Reuse_Stream *r) {
+	Reuse_Line *old = r->lines;
+	uint32_t i, cap = r->capacity, s;
+
+	r->capacity = cap ? cap * 2 : 1024;
+	r->lines = malloc(r->capacity * sizeof(Reuse_Line));
+	memset(r->lines, 0xFF, r->capacity * sizeof(Reuse_Line));
+	for (i = 0; i < cap; i++) {
+		if (old[i].line != REUSE_EMPTY) {
+			s = reuse_slot(r, old[i].line);
+			r->lines[s] = old[i];
+			r->owner[old[i].last] = s;
+		}
+	}
+	free(old);
+}
+
+/* Fold the open window into the working-set statistics and open window w */
+void reuse_close_window(uint32_t w) {
+	int s;
+
+	for (s = 0; s < NUM_REUSE_STREAMS; s++) {
+		REUSE[s].ws_sum += REUSE[s].window_lines;
+		if (REUSE[s].window_lines > REUSE[s].ws_peak) {
+			REUSE[s].ws_peak = REUSE[s].window_lines;
+		}
+		REUSE[s].window_lines = 0;
+	}
+	REUSE_CLOSED_WINDOWS += w - REUSE_OPEN_WINDOW; // windows skipped without a reference held nothing
+	REUSE_OPEN_WINDOW = w;
+}
+
+/***************************************************************/
+/* Record one reference to addr: called from the fetch stage   */
+/* of every pipeline and from mem_access_hooks()                */
+/***************************************************************/
+void reuse_access(reuse_stream_t stream, uint32_t addr) {
+	Reuse_Stream *r = &REUSE[stream];
+	uint32_t line = addr >> REUSE_LINE_SHIFT, window = CYCLE_COUNT / REUSE_WINDOW, slot, d;
+	reuse_region_t region = reuse_region(addr);
+
+	if (PARALLEL_ACTIVE) {
+		pthread_mutex_lock(&REUSE_LOCK);
+	}
+	if (r->size == 0) {
+		r->size = 1 << 12;
+		r->tree = calloc(r->size + 1, sizeof(uint32_t));
+		r->owner = malloc(r->size * sizeof(uint32_t));
+		memset(r->owner, 0xFF, r->size * sizeof(uint32_t));
+	}
+	if ((r->count + 1) * 2 > r->capacity) {
+		reuse_grow(r);
+	}
+	if (r->now == r->size) {
+		reuse_compact(r);
+	}
+	if (window > REUSE_OPEN_WINDOW) {
+		reuse_close_window(window);
+	}
+	REUSE_REFS[region]++;
+
+	slot = reuse_slot(r, line);
+	if (r->lines[slot].line == REUSE_EMPTY) {
+		r->lines[slot].line = line;
+		r->lines[slot].window = 0;
+		r->count++;
+		r->hist[REUSE_COLD]++;
+		REUSE_FOOTPRINT[region]++;
+	}
+	else {
+		d = reuse_prefix(r, r->now) - reuse_prefix(r, r->lines[slot].last + 1);
+		r->hist[d ? 32 - __builtin_clz(d) : 0]++;
+		reuse_add(r, r->lines[slot].last, -1);
+		r->owner[r->lines[slot].last] = REUSE_EMPTY;
+	}
+	r->lines[slot].last = r->now;
+	r->owner[r->now] = slot;
+	reuse_add(r, r->now, 1);
+	r->now++;
+	if (r->lines[slot].window != window + 1) {
+		r->lines[slot].window = window + 1;
+		r->window_lines++;
+	}
+	if (PARALLEL_ACTIVE) {
+		pthread_mutex_unlock(&REUSE_LOCK);
+	}
+}
+
+/* References in stream s with reuse distance below 2^bucket lines, so they hit a fully associative LRU cache that size */
+uint64_t reuse_hits(reuse_stream_t s, int bucket) {
+	uint64_t hits = 0;
+	int b;
+
+	for (b = 0; b <= bucket && b < REUSE_BUCKETS; b++) {
+		hits += REUSE[s].hist[b];
+	}
+	return hits;
+}
+
+uint64_t reuse_refs(reuse_stream_t s) {
+	return reuse_hits(s, REUSE_BUCKETS) + REUSE[s].hist[REUSE_COLD];
+}
+
+/* Working-set mean and peak over the closed windows and the open one, in lines */
+double reuse_ws_mean(reuse_stream_t s) {
+	return (double)(REUSE[s].ws_sum + REUSE[s].window_lines) / (REUSE_CLOSED_WINDOWS + 1);
+}
+
+uint32_t reuse_ws_peak(reuse_stream_t s) {
+	return REUSE[s].window_lines > REUSE[s].ws_peak ? REUSE[s].window_lines : REUSE[s].ws_peak;
+}
+
+/* Smallest power-of-two cache, in bytes, that catches fraction of the references that are not cold */
+uint64_t reuse_cache_for(reuse_stream_t s, double fraction) {
+	uint64_t warm = reuse_hits(s, REUSE_BUCKETS);
+	int b;
+
+	for (b = 0; b < REUSE_BUCKETS; b++) {
+		if (reuse_hits(s, b) >= fraction * warm) {
+			return (uint64_t)1 << (b + REUSE_LINE_SHIFT);
+		}
+	}
+	return (uint64_t)1 << (REUSE_BUCKETS - 1 + REUSE_LINE_SHIFT);
+}
+
+/************************************************************/
+/* Print the reuse-distance histograms, working set and     */
+/* per-region footprint                                     */
+/************************************************************/
+void reuse_dump() {
+	uint64_t refs[NUM_REUSE_STREAMS];
+	char label[24];
+	int b, top = 0, s;
+
+	for (s = 0; s < NUM_REUSE_STREAMS; s++) {
+		refs[s] = reuse_refs(s);
+		for (b = 0; b < REUSE_BUCKETS; b++) {
+			if (REUSE[s].hist[b] && b > top) {
+				top = b;
+			}
+		}
+	}
+	printf("-------------------------------------------------------------\n");
+	printf("Reuse distance %s: distinct %d-byte lines between references\n", REUSE_ENABLED ? "ON" : "OFF", 1 << REUSE_LINE_SHIFT);
+	printf("-------------------------------------------------------------\n");
+	printf("[Distance]\t[LRU cache]\t[Inst]\t[Hit%%]\t[Data]\t[Hit%%]\n");
+	printf("-------------------------------------------------------------\n");
+	for (b = 0; b <= top; b++) {
+		b < 2 ? snprintf(label, sizeof(label), "%d", b) : snprintf(label, sizeof(label), "%u-%u", 1u << (b - 1), (uint32_t)((1ull << b) - 1));
+		printf("%-16s%llu B\t", label, (unsigned long long)1 << (b + REUSE_LINE_SHIFT));
+		for (s = 0; s < NUM_REUSE_STREAMS; s++) {
+			printf("\t%llu\t%.2f", (unsigned long long)REUSE[s].hist[b], refs[s] ? 100.0 * reuse_hits(s, b) / refs[s] : 0.0);
+		}
+		printf("\n");
+	}
+	printf("cold\t\t-\t\t%llu\t-\t%llu\t-\n", (unsigned long long)REUSE[REUSE_INST].hist[REUSE_COLD],
+		(unsigned long long)REUSE[REUSE_DATA].hist[REUSE_COLD]);
+	printf("-------------------------------------------------------------\n");
+	for (s = 0; s < NUM_REUSE_STREAMS; s++) {
+		printf("%s\t%llu refs, 90%% of reuse within %llu B, 99%% within %llu B\n", REUSE_STREAM_NAMES[s],
+			(unsigned long long)refs[s], (unsigned long long)reuse_cache_for(s, 0.90), (unsigned long long)reuse_cache_for(s, 0.99));
+	}
+	printf("-------------------------------------------------------------\n");
+	printf("Working set over %llu windows of %u cycles\n", (unsigned long long)REUSE_CLOSED_WINDOWS + 1, REUSE_WINDOW);
+	for (s = 0; s < NUM_REUSE_STREAMS; s++) {
+		printf("%s\tmean %.1f lines (%.0f B), peak %u lines (%u B)\n", REUSE_STREAM_NAMES[s], reuse_ws_mean(s),
+			reuse_ws_mean(s) * (1 << REUSE_LINE_SHIFT), reuse_ws_peak(s), reuse_ws_peak(s) << REUSE_LINE_SHIFT);
+	}
+	printf("-------------------------------------------------------------\n");
+	printf("[Region]\t[Lines]\t[Bytes]\t\t[Refs]\n");
+	printf("-------------------------------------------------------------\n");
+	for (s = 0; s < NUM_REUSE_REGIONS; s++) {
+		printf("%s\t\t%llu\t%llu\t\t%llu\n", REUSE_REGION_NAMES[s], (unsigned long long)REUSE_FOOTPRINT[s],
+			(unsigned long long)REUSE_FOOTPRINT[s] << REUSE_LINE_SHIFT, (unsigned long long)REUSE_REFS[s]);
+	}
+	printf("-------------------------------------------------------------\n");
+}
@@ -0,0 +1,207 @@
+/******************************************************************************/
+/* MACHINE-READABLE STATISTICS                                                */
+/******************************************************************************/
+int BATCH_MODE;               // no prompt or menus; exit code reports how the run ended
+const char *STATS_JSON_PATH;  // final JSON dump ("-" = stdout), or NULL
+const char *STATS_CSV_PATH;   // final CSV dump ("-" = stdout), or NULL
+
+/* Exit codes */
+#define EXIT_HALTED   0  // guest program reached its exit syscall
+#define EXIT_USAGE    1  // bad command line or unreadable file
+#define EXIT_STOPPED  2  // run length or script ran out before the guest halted
+#define EXIT_GUEST_FAILED 3  // guest exited through syscall 17 with a non-zero code
+
+/* Write s as a JSON string literal */
+void stats_write_json_string(FILE *fp, const char *s) {
+	fputc('"', fp);
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\') {
+			fprintf(fp, "\\%c", *s);
+		}
+		else if ((unsigned char)*s < 0x20) {
+			fprintf(fp, "\\u%04x", (unsigned char)*s);
+		}
+		else {
+			fputc(*s, fp);
+		}
+	}
+	fputc('"', fp);
+}
+
+void stats_write_json(FILE *fp) {
+	int i, j;
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"program\": ");
+	stats_write_json_string(fp, prog_file);
+	fprintf(fp, ",\n");
+	fprintf(fp, "  \"halted\": %s,\n", RUN_FLAG ? "false" : "true");
+	fprintf(fp, "  \"cycles\": %u,\n", CYCLE_COUNT);
+	fprintf(fp, "  \"instructions\": %u,\n", INSTRUCTION_COUNT);
+	fprintf(fp, "  \"cpi\": %.6f,\n", INSTRUCTION_COUNT ? (double)CYCLE_COUNT / INSTRUCTION_COUNT : 0.0);
+	fprintf(fp, "  \"config\": { \"forwarding\": %d, \"miss_penalty\": %u, \"issue_width\": %u, \"ooo\": %d },\n", ENABLE_FORWARDING, CACHE_MISS_PENALTY, ISSUE_WIDTH, OOO_ENABLED);
+	fprintf(fp, "  \"pc\": %u,\n", CURRENT_STATE.PC);
+	fprintf(fp, "  \"regs\": [");
+	for (i = 0; i < MIPS_REGS; i++) {
+		fprintf(fp, "%s%u", i ? ", " : "", CURRENT_STATE.REGS[i]);
+	}
+	fprintf(fp, "],\n");
+	fprintf(fp, "  \"hi\": %u,\n", CURRENT_STATE.HI);
+	fprintf(fp, "  \"lo\": %u,\n", CURRENT_STATE.LO);
+	fprintf(fp, "  \"cache\": { \"hits\": %u, \"misses\": %u },\n", cache_hits, cache_misses);
+	if (VICTIM_ENTRIES) {
+		fprintf(fp, "  \"victim\": { \"mode\": \"%s\", \"entries\": %u, \"probes\": %llu, \"hits\": %llu, \"inserts\": %llu },\n",
+			VICTIM_MODE == VICTIM_CACHE ? "victim" : "miss", VICTIM_ENTRIES, (unsigned long long)VICTIM_PROBES,
+			(unsigned long long)VICTIM_HITS, (unsigned long long)VICTIM_INSERTS);
+	}
+	if (MSHR_COUNT) {
+		fprintf(fp, "  \"mshr\": { \"count\": %u, \"primary\": %llu, \"secondary\": %llu, \"hit_under_miss\": %llu, "
+			"\"full_stalls\": %llu, \"full_cycles\": %llu, \"dep_cycles\": %llu, \"busy_cycles\": %llu, \"mlp\": %.6f },\n",
+			MSHR_COUNT, (unsigned long long)MSHR_PRIMARY, (unsigned long long)MSHR_SECONDARY,
+			(unsigned long long)MSHR_HIT_UNDER_MISS, (unsigned long long)MSHR_FULL_STALLS, (unsigned long long)MSHR_FULL_CYCLES,
+			(unsigned long long)MSHR_DEP_CYCLES, (unsigned long long)MSHR_BUSY_CYCLES,
+			MSHR_BUSY_CYCLES ? (double)MSHR_MISS_CYCLES / MSHR_BUSY_CYCLES : 0.0);
+	}
+	if (DRAM_ENABLED) {
+		fprintf(fp, "  \"dram\": { \"channels\": %u, \"ranks\": %u, \"banks\": %u, \"policy\": \"%s\", \"reads\": %llu, \"writes\": %llu, "
+			"\"row_hits\": %llu, \"row_empty\": %llu, \"row_conflicts\": %llu, \"read_latency\": %llu, \"utilization\": %.6f },\n",
+			DRAM_CHANNELS, DRAM_RANKS, DRAM_BANKS, DRAM_POLICY == DRAM_OPEN_PAGE ? "open" : "closed",
+			(unsigned long long)DRAM_READS, (unsigned long long)DRAM_WRITES, (unsigned long long)DRAM_ROW_HITS,
+			(unsigned long long)DRAM_ROW_EMPTY, (unsigned long long)DRAM_ROW_CONFLICTS, (unsigned long long)DRAM_READ_LATENCY,
+			dram_utilization());
+	}
+	if (REUSE_ENABLED) {
+		fprintf(fp, "  \"reuse\": { \"line_bytes\": %d, \"window\": %u, \"windows\": %llu,", 1 << REUSE_LINE_SHIFT, REUSE_WINDOW,
+			(unsigned long long)REUSE_CLOSED_WINDOWS + 1);
+		for (i = 0; i < NUM_REUSE_STREAMS; i++) {
+			fprintf(fp, " \"%s\": { \"cold\": %llu, \"ws_mean\": %.3f, \"ws_peak\": %u, \"histogram\": [", REUSE_STREAM_NAMES[i],
+				(unsigned long long)REUSE[i].hist[REUSE_COLD], reuse_ws_mean(i), reuse_ws_peak(i));
+			for (j = 0; j < REUSE_BUCKETS; j++) {
+				fprintf(fp, "%s%llu", j ? ", " : "", (unsigned long long)REUSE[i].hist[j]);
+			}
+			fprintf(fp, "] },");
+		}
+		fprintf(fp, " \"footprint\": {");
+		for (i = 0; i < NUM_REUSE_REGIONS; i++) {
+			fprintf(fp, "%s \"%s\": { \"lines\": %llu, \"refs\": %llu }", i ? "," : "", REUSE_REGION_NAMES[i],
+				(unsigned long long)REUSE_FOOTPRINT[i], (unsigned long long)REUSE_REFS[i]);
+		}
+		fprintf(fp, " } },\n");
+	}
+	fprintf(fp, "  \"syscalls\": { \"calls\": %llu, \"output_bytes\": %llu, \"flushes\": %llu, \"heap_bytes\": %u, \"exit_code\": %d },\n",
+		(unsigned long long)SYSCALL_CALLS, (unsigned long long)SYSCALL_OUT_BYTES, (unsigned long long)SYSCALL_FLUSHES,
+		SYSCALL_BRK - SYSCALL_HEAP_BEGIN, SYSCALL_EXIT_CODE);
+	fprintf(fp, "  \"funits\": {");
+	for (i = 0; i < NUM_FUNITS; i++) {
+		fprintf(fp, "%s \"%s\": { \"latency\": %u, \"pipelined\": %d, \"ops\": %llu, \"busy_cycles\": %llu }",
+			i ? "," : "", FUNIT_NAMES[i], FUNITS[i].latency, FUNITS[i].pipelined,
+			(unsigned long long)FU_OPS[i], (unsigned long long)FU_BUSY_CYCLES[i]);
+	}
+	fprintf(fp, ", \"hilo_cycles\": %llu },\n", (unsigned long long)FU_HILO_CYCLES);
+	if (OOO_ENABLED) {
+		fprintf(fp, "  \"ooo\": { \"width\": %u, \"rob\": %u, \"rs\": %u, \"lsq\": %u, \"cycles\": %llu, \"dispatched\": %llu, \"squashed\": %llu, ",
+			OOO_WIDTH, OOO_ROB_SIZE, OOO_RS_SIZE, OOO_LSQ_SIZE, (unsigned long long)OOO_CYCLES,
+			(unsigned long long)OOO_DISPATCHED, (unsigned long long)OOO_SQUASHED);
+		fprintf(fp, "\"branches\": %llu, \"mispredicts\": %llu, \"forwarded\": %llu, \"load_blocked\": %llu, ",
+			(unsigned long long)OOO_BRANCHES, (unsigned long long)OOO_MISPREDICTS,
+			(unsigned long long)OOO_FORWARDED, (unsigned long long)OOO_LOAD_BLOCKED);
+		fprintf(fp, "\"rob_full\": %llu, \"rs_full\": %llu, \"lsq_full\": %llu, \"rob_occupancy\": %.6f },\n",
+			(unsigned long long)OOO_ROB_FULL, (unsigned long long)OOO_RS_FULL, (unsigned long long)OOO_LSQ_FULL,
+			OOO_CYCLES ? (double)OOO_ROB_OCCUPANCY / OOO_CYCLES : 0.0);
+	}
+	if (ISSUE_WIDTH > 1) {
+		fprintf(fp, "  \"superscalar\": { \"cycles\": %llu, \"issued\": [", (unsigned long long)SS_CYCLES);
+		for (i = 0; i <= MAX_ISSUE_WIDTH; i++) {
+			fprintf(fp, "%s%llu", i ? ", " : "", (unsigned long long)SS_ISSUED[i]);
+		}
+		fprintf(fp, "], \"dual_issue_rate\": %.6f", SS_CYCLES ? (double)SS_ISSUED[MAX_ISSUE_WIDTH] / SS_CYCLES : 0.0);
+		for (i = 0; i < NUM_SS_SPLITS; i++) {
+			fprintf(fp, ", \"split_%s\": %llu", SS_SPLIT_NAMES[i], (unsigned long long)SS_SPLITS[i]);
+		}
+		fprintf(fp, " },\n");
+	}
+	if (PREFETCHER != PREFETCH_NONE) {
+		fprintf(fp, "  \"prefetch\": { \"prefetcher\": \"%s\", \"degree\": %u, \"issued\": %llu, \"useful\": %llu, \"late\": %llu, "
+			"\"late_cycles\": %llu, \"unused\": %llu, \"bus_wait\": %llu },\n", PREFETCHER_NAMES[PREFETCHER], PREFETCH_DEGREE,
+			(unsigned long long)PF_ISSUED, (unsigned long long)PF_USEFUL, (unsigned long long)PF_LATE,
+			(unsigned long long)PF_LATE_CYCLES, (unsigned long long)PF_UNUSED, (unsigned long long)PF_BUS_WAIT);
+	}
+	if (NUM_CORES > 1) {
+		fprintf(fp, "  \"cores\": [");
+		for (i = 0; i < NUM_CORES; i++) {
+			fprintf(fp, "%s\n    { \"halted\": %s, \"cycles\": %llu, \"instructions\": %llu, \"cache_hits\": %llu, \"cache_misses\": %llu, "
+				"\"bus_rd\": %llu, \"bus_rdx\": %llu, \"bus_upgr\": %llu, \"bus_wr\": %llu, "
+				"\"inval_sent\": %llu, \"inval_recv\": %llu, \"flushes\": %llu }", i ? "," : "",
+				CORES[i].halted ? "true" : "false",
+				(unsigned long long)CORE_STATS[i].cycles, (unsigned long long)CORE_STATS[i].instructions,
+				(unsigned long long)CORE_STATS[i].cache_hits, (unsigned long long)CORE_STATS[i].cache_misses,
+				(unsigned long long)CORE_STATS[i].bus_rd, (unsigned long long)CORE_STATS[i].bus_rdx,
+				(unsigned long long)CORE_STATS[i].bus_upgr, (unsigned long long)CORE_STATS[i].bus_wr,
+				(unsigned long long)CORE_STATS[i].inval_sent, (unsigned long long)CORE_STATS[i].inval_recv,
+				(unsigned long long)CORE_STATS[i].flushes);
+		}
+		fprintf(fp, "\n  ],\n");
+	}
+	fprintf(fp, "  \"counters\": {");
+	for (i = 0; i < NUM_PERF_COUNTERS; i++) {
+		fprintf(fp, "%s\n    \"%s\": %llu", i ? "," : "", PERF_COUNTER_NAMES[i], (unsigned long long)PERF_COUNTERS[i]);
+	}
+	fprintf(fp, "\n  }\n");
+	fprintf(fp, "}\n");
+}
+
+/* One header row and one value row; to combine runs, keep the first file's header and drop the rest (tail -n +2) */
+void stats_write_csv(FILE *fp) {
+	int i;
+	fprintf(fp, "program,halted,cycles,instructions,forwarding,miss_penalty,pc");
+	for (i = 0; i < MIPS_REGS; i++) {
+		fprintf(fp, ",r%d", i);
+	}
+	fprintf(fp, ",hi,lo,cache.hits,cache.misses");
+	for (i = 0; i < NUM_PERF_COUNTERS; i++) {
+		fprintf(fp, ",%s", PERF_COUNTER_NAMES[i]);
+	}
+	fprintf(fp, "\n");
+	fprintf(fp, "%s,%d,%u,%u,%d,%u,%u", prog_file, RUN_FLAG ? 0 : 1, CYCLE_COUNT, INSTRUCTION_COUNT,
+		ENABLE_FORWARDING, CACHE_MISS_PENALTY, CURRENT_STATE.PC);
+	for (i = 0; i < MIPS_REGS; i++) {
+		fprintf(fp, ",%u", CURRENT_STATE.REGS[i]);
+	}
+	fprintf(fp, ",%u,%u,%u,%u", CURRENT_STATE.HI, CURRENT_STATE.LO, cache_hits, cache_misses);
+	for (i = 0; i < NUM_PERF_COUNTERS; i++) {
+		fprintf(fp, ",%llu", (unsigned long long)PERF_COUNTERS[i]);
+	}
+	fprintf(fp, "\n");
+}
+
+void stats_write(const char *path, void (*writer)(FILE *)) {
+	FILE *fp;
+	if (path == NULL) {
+		return;
+	}
+	if (strcmp(path, "-") == 0) {
+		writer(stdout);
+		fflush(stdout);
+		return;
+	}
+	fp = fopen(path, "w");
+	if (fp == NULL) {
+		printf("Error: Can't open stats file %s\n", path);
+		return;
+	}
+	writer(fp);
+	fclose(fp);
+}
+
+/***************************************************************/
+/* Write the requested dumps and leave the simulator            */
+/***************************************************************/
+void sim_exit() {
+	telemetry_stop();
+	syscall_flush();
+	stats_write(STATS_JSON_PATH, stats_write_json);
+	stats_write(STATS_CSV_PATH, stats_write_csv);
+	if (BATCH_MODE) {
+		exit(RUN_FLAG ? EXIT_STOPPED : SYSCALL_EXIT_CODE ? EXIT_GUEST_FAILED : EXIT_HALTED);
+	}
+	exit(0);
+}
@@ -0,0 +1,548 @@
+/******************************************************************************/
+/* DUAL-ISSUE IN-ORDER SUPERSCALAR PIPELINE                                   */
+/******************************************************************************/
+#define MAX_ISSUE_WIDTH 2
+
+/* Why slot 1 stayed empty in a cycle where slot 0 issued */
+typedef enum {
+	SS_SPLIT_EMPTY,     // nothing decoded behind slot 0
+	SS_SPLIT_DEPENDENT, // reads a register slot 0 writes
+	SS_SPLIT_MEMORY,    // second load/store: one memory port
+	SS_SPLIT_BRANCH,    // branches and jumps issue in slot 0 only
+	SS_SPLIT_SERIAL,    // syscall issues alone
+	SS_SPLIT_UNIT,      // one multiplier/divider port
+	SS_SPLIT_HAZARD,    // waits on an older instruction still in flight
+	NUM_SS_SPLITS
+} ss_split_t;
+
+const char *SS_SPLIT_NAMES[NUM_SS_SPLITS] = { "empty", "dependent", "memory", "branch", "serial", "unit", "hazard" };
+
+/* One core's wide pipeline; each latch holds MAX_ISSUE_WIDTH instructions, oldest first */
+typedef struct SS_Pipeline_Struct {
+	SS_Slot IF_ID[MAX_ISSUE_WIDTH];
+	SS_Slot ID_EX[MAX_ISSUE_WIDTH];
+	SS_Slot EX_MEM[MAX_ISSUE_WIDTH];
+	SS_Slot MEM_WB[MAX_ISSUE_WIDTH];
+	int redirect;       // a taken branch resolved this cycle: no fetch until the next one
+	int refill;         // the front end is empty after a redirect
+} SS_Pipeline;
+
+uint32_t ISSUE_WIDTH = 1;           // 1 = the scalar pipeline in handle_pipeline()
+SS_Pipeline SS_STATE[MAX_CORES];    // indexed by CURRENT_CORE
+
+/* Statistics, shared by all cores */
+uint64_t SS_CYCLES;                 // cycles the wide pipeline advanced
+uint64_t SS_ISSUED[MAX_ISSUE_WIDTH + 1]; // cycles by instructions issued
+uint64_t SS_SPLITS[NUM_SS_SPLITS];
+
+void ss_reset() {
+	memset(SS_STATE, 0, sizeof(SS_STATE));
+	SS_CYCLES = 0;
+	memset(SS_ISSUED, 0, sizeof(SS_ISSUED));
+	memset(SS_SPLITS, 0, sizeof(SS_SPLITS));
+}
+
+/* Fill in the class and register operands of the instruction ir at pc */
+void ss_decode(SS_Slot *s, uint32_t ir, uint32_t pc) {
+	uint32_t opcode = (ir & 0xFC000000) >> 26, function = ir & 0x0000003F;
+	uint8_t rs = (ir & 0x03E00000) >> 21, rt = (ir & 0x001F0000) >> 16, rd = (ir & 0x0000F800) >> 11;
+
+	memset(s, 0, sizeof(*s));
+	s->valid = TRUE;
+	s->ir = ir;
+	s->pc = pc;
+	s->cls = SS_ALU;
+	if (opcode == 0x00) {
+		switch (function) {
+			case 0x00: case 0x02: case 0x03: s->src[1] = rt; s->dest[0] = rd; break;          // SLL, SRL, SRA
+			case 0x08: s->cls = SS_JUMP; s->src[0] = rs; break;                               // JR
+			case 0x09: s->cls = SS_JUMP; s->src[0] = rs; s->dest[0] = rd; break;              // JALR
+			case 0x0C: s->cls = SS_SYSCALL; s->src[0] = 2; break;                             // SYSCALL reads $v0
+			case 0x10: s->src[0] = REG_HI; s->dest[0] = rd; break;                            // MFHI
+			case 0x11: s->src[0] = rs; s->dest[0] = REG_HI; break;                            // MTHI
+			case 0x12: s->src[0] = REG_LO; s->dest[0] = rd; break;                            // MFLO
+			case 0x13: s->src[0] = rs; s->dest[0] = REG_LO; break;                            // MTLO
+			case 0x18: case 0x19: case 0x1A: case 0x1B:                                      // MULT, MULTU, DIV, DIVU
+				s->cls = SS_MULDIV;
+				s->src[0] = rs;
+				s->src[1] = rt;
+				s->dest[0] = REG_HI;
+				s->dest[1] = REG_LO;
+				break;
+			default: s->src[0] = rs; s->src[1] = rt; s->dest[0] = rd; break;
+		}
+		return;
+	}
+	switch (opcode) {
+		case 0x01: case 0x06: case 0x07: s->cls = SS_BRANCH; s->src[0] = rs; break;           // BLTZ/BGEZ, BLEZ, BGTZ
+		case 0x04: case 0x05: s->cls = SS_BRANCH; s->src[0] = rs; s->src[1] = rt; break;      // BEQ, BNE
+		case 0x02: s->cls = SS_JUMP; break;                                                   // J
+		case 0x03: s->cls = SS_JUMP; s->dest[0] = 31; break;                                  // JAL
+		case 0x0F: s->dest[0] = rt; break;                                                    // LUI
+		case 0x20: case 0x21: case 0x23: s->cls = SS_LOAD; s->src[0] = rs; s->dest[0] = rt; break;
+		case 0x28: case 0x29: case 0x2B: s->cls = SS_STORE; s->src[0] = rs; s->src[1] = rt; break;
+		default: s->src[0] = rs; s->dest[0] = rt; break;                                      // immediate ALU ops
+	}
+}
+
+/* Value of register r as the forwarding network sees it: both MEM/WB slots, then the register file */
+uint32_t ss_operand(SS_Pipeline *p, uint8_t r) {
+	int i, k;
+
+	if (r == 0) {
+		return 0;
+	}
+	for (i = MAX_ISSUE_WIDTH - 1; i >= 0; i--) {
+		for (k = 1; k >= 0; k--) {
+			if (p->MEM_WB[i].valid && p->MEM_WB[i].dest[k] == r) {
+				return p->MEM_WB[i].result[k];
+			}
+		}
+	}
+	return r == REG_HI ? CURRENT_STATE.HI : r == REG_LO ? CURRENT_STATE.LO : CURRENT_STATE.REGS[r];
+}
+
+/* Execute s on operand values a, b; returns TRUE with *target set when it redirects fetch */
+int ss_evaluate(SS_Slot *s, uint32_t a, uint32_t b, uint32_t *target) {
+	uint32_t ir = s->ir, opcode = (ir & 0xFC000000) >> 26, function = ir & 0x0000003F;
+	uint32_t rt = (ir & 0x001F0000) >> 16, sa = (ir & 0x000007C0) >> 6;
+	uint32_t imm = ir & 0x0000FFFF, simm = (imm & 0x8000) ? (imm | 0xFFFF0000) : imm;
+	uint32_t branch = s->pc + (simm << 2); // offsets are relative to the branch, as in EX()
+	uint64_t product;
+	int taken = FALSE;
+
+	if (opcode == 0x00) {
+		switch (function) {
+			case 0x00: s->result[0] = b << sa; break;                        // SLL
+			case 0x02: s->result[0] = b >> sa; break;                        // SRL
+			case 0x03: s->result[0] = (uint32_t)((int32_t)b >> sa); break;   // SRA
+			case 0x08: *target = a; return TRUE;                             // JR
+			case 0x09: s->result[0] = s->pc + 4; *target = a; return TRUE;   // JALR
+			case 0x0C: s->result[0] = a; break;                              // SYSCALL: $v0 checked at WB
+			case 0x10: case 0x11: case 0x12: case 0x13: s->result[0] = a; break; // MFHI, MTHI, MFLO, MTLO
+			case 0x18:                                                       // MULT
+				product = (uint64_t)((int64_t)(int32_t)a * (int64_t)(int32_t)b);
+				s->result[0] = product >> 32;
+				s->result[1] = (uint32_t)product;
+				break;
+			case 0x19:                                                       // MULTU
+				product = (uint64_t)a * b;
+				s->result[0] = product >> 32;
+				s->result[1] = (uint32_t)product;
+				break;
+			case 0x1A: case 0x1B:                                            // DIV, DIVU
+				if (b == 0) { // result undefined: HI/LO keep their values
+					s->dest[0] = s->dest[1] = 0;
+				}
+				else if (function == 0x1A) {
+					s->result[0] = (uint32_t)((int32_t)a % (int32_t)b);
+					s->result[1] = (uint32_t)((int32_t)a / (int32_t)b);
+				}
+				else {
+					s->result[0] = a % b;
+					s->result[1] = a / b;
+				}
+				break;
+			case 0x20: case 0x21: s->result[0] = a + b; break;               // ADD, ADDU
+			case 0x22: case 0x23: s->result[0] = a - b; break;               // SUB, SUBU
+			case 0x24: s->result[0] = a & b; break;                          // AND
+			case 0x25: s->result[0] = a | b; break;                          // OR
+			case 0x26: s->result[0] = a ^ b; break;                          // XOR
+			case 0x27: s->result[0] = ~(a | b); break;                       // NOR
+			case 0x2A: s->result[0] = (int32_t)a < (int32_t)b; break;        // SLT
+			default:
+				TRACE("EX at 0x%x is not implemented!\n", s->pc);
+				s->dest[0] = 0;
+				break;
+		}
+		return FALSE;
+	}
+	switch (opcode) {
+		case 0x01: taken = rt == 0 ? (int32_t)a < 0 : (int32_t)a >= 0; break; // BLTZ, BGEZ
+		case 0x02: case 0x03:                                            // J, JAL
+			s->result[0] = s->pc + 4;
+			*target = (s->pc & 0xF0000000) | ((ir & 0x03FFFFFF) << 2);
+			return TRUE;
+		case 0x04: taken = a == b; break;                                // BEQ
+		case 0x05: taken = a != b; break;                                // BNE
+		case 0x06: taken = (int32_t)a <= 0; break;                       // BLEZ
+		case 0x07: taken = (int32_t)a > 0; break;                        // BGTZ
+		case 0x08: case 0x09: s->result[0] = a + simm; break;            // ADDI, ADDIU
+		case 0x0A: s->result[0] = (int32_t)a < (int32_t)simm; break;     // SLTI
+		case 0x0C: s->result[0] = a & imm; break;                        // ANDI
+		case 0x0D: s->result[0] = a | imm; break;                        // ORI
+		case 0x0E: s->result[0] = a ^ imm; break;                        // XORI
+		case 0x0F: s->result[0] = imm << 16; break;                      // LUI
+		case 0x20: case 0x21: case 0x23: case 0x28: case 0x29: case 0x2B: // loads and stores
+			s->addr = a + simm;
+			s->data = b;
+			break;
+		default:
+			TRACE("EX at 0x%x is not implemented!\n", s->pc);
+			s->dest[0] = 0;
+			break;
+	}
+	if (taken) {
+		*target = branch;
+	}
+	return taken;
+}
+
+/* Execute s with operands from the forwarding network */
+int ss_execute(SS_Pipeline *p, SS_Slot *s, uint32_t *target) {
+	return ss_evaluate(s, ss_operand(p, s->src[0]), ss_operand(p, s->src[1]), target);
+}
+
+/* Load result from the aligned word holding s->addr: LB/LH sign-extend */
+uint32_t ss_load_value(SS_Slot *s, uint32_t word) {
+	uint32_t opcode = (s->ir & 0xFC000000) >> 26, shift = (s->addr & 3) * 8;
+
+	if (opcode == 0x20) {
+		return (uint32_t)(int32_t)(int8_t)(word >> shift);
+	}
+	if (opcode == 0x21) {
+		return (uint32_t)(int32_t)(int16_t)(word >> (shift & 16));
+	}
+	return word;
+}
+
+/* Aligned word holding s->addr after an SB/SH writes its byte/halfword into it */
+uint32_t ss_store_merge(SS_Slot *s, uint32_t word) {
+	uint32_t shift = (s->addr & 3) * 8;
+
+	if (((s->ir & 0xFC000000) >> 26) == 0x28) {
+		return (word & ~(0xFFu << shift)) | ((s->data & 0xFF) << shift);
+	}
+	shift &= 16;
+	return (word & ~(0xFFFFu << shift)) | ((s->data & 0xFFFF) << shift);
+}
+
+/* Load/store through the L1, TRUE when it missed; SB/SH write memory directly and patch any cached copy */
+int ss_access(SS_Slot *s) {
+	uint32_t opcode = (s->ir & 0xFC000000) >> 26, misses = cache_misses, word, i;
+	uint32_t index = (s->addr & 0x000000F0) >> 4;
+
+	switch (opcode) {
+		case 0x20: case 0x21: case 0x23: // LB, LH, LW
+			word = cache_isHit(s->addr) ? cache_read_32(s->addr) : cache_load_32(s->addr);
+			s->result[0] = ss_load_value(s, word);
+			break;
+		case 0x28: case 0x29: // SB, SH
+			word = ss_store_merge(s, mem_read_32(s->addr & ~3u));
+			mem_write_32(s->addr & ~3u, word);
+			cache_update_32(s->addr, word);
+			break;
+		case 0x2B: // SW: write-allocate, then write the line through
+			if (!cache_isHit(s->addr)) {
+				cache_load_32(s->addr);
+			}
+			cache_write_32(s->addr, s->data);
+			for (i = 0; i < WORD_PER_BLOCK; i++) {
+				mem_write_32((s->addr & 0xFFFFFFF0) + i * 4, L1Cache.blocks[index].words[i]);
+			}
+			break;
+	}
+	return cache_misses != misses;
+}
+
+/* MEM stage work for s: the access, then every model watching the data side */
+void ss_memory(SS_Slot *s) {
+	if (s->cls == SS_LOAD || s->cls == SS_STORE) {
+		mem_access_done(s->ir, s->pc, s->addr, ss_access(s));
+	}
+}
+
+/* TRUE when s cannot enter EX next cycle because of an older instruction in flight */
+int ss_hazard(SS_Pipeline *p, SS_Slot *s, perf_counter_t *cause) {
+	int i, j, k;
+
+	for (j = 0; j < 2; j++) {
+		if (s->src[j] == 0) {
+			continue;
+		}
+		for (i = 0; i < MAX_ISSUE_WIDTH; i++) {
+			for (k = 0; k < 2; k++) {
+				if (p->EX_MEM[i].valid && p->EX_MEM[i].dest[k] == s->src[j]) {
+					if (p->EX_MEM[i].cls == SS_LOAD) { // load data only exists after MEM
+						*cause = PERF_LOAD_USE;
+						return TRUE;
+					}
+					if (!ENABLE_FORWARDING) {
+						*cause = PERF_RAW_STALL;
+						return TRUE;
+					}
+				}
+				if (!ENABLE_FORWARDING && p->MEM_WB[i].valid && p->MEM_WB[i].dest[k] == s->src[j]) {
+					*cause = PERF_RAW_STALL;
+					return TRUE;
+				}
+			}
+		}
+	}
+	return FALSE;
+}
+
+/* Why the slot-1 candidate s1 cannot issue beside s0, or NUM_SS_SPLITS when it can */
+ss_split_t ss_pair_rule(SS_Pipeline *p, SS_Slot *s0, SS_Slot *s1) {
+	perf_counter_t cause;
+	int j, k;
+
+	if (!s1->valid) {
+		return SS_SPLIT_EMPTY;
+	}
+	if (s1->cls == SS_BRANCH || s1->cls == SS_JUMP) {
+		return SS_SPLIT_BRANCH;
+	}
+	if (s0->cls == SS_SYSCALL || s1->cls == SS_SYSCALL) {
+		return SS_SPLIT_SERIAL;
+	}
+	if ((s0->cls == SS_LOAD || s0->cls == SS_STORE) && (s1->cls == SS_LOAD || s1->cls == SS_STORE)) {
+		return SS_SPLIT_MEMORY;
+	}
+	if (s0->cls == SS_MULDIV && s1->cls == SS_MULDIV) {
+		return SS_SPLIT_UNIT;
+	}
+	for (j = 0; j < 2; j++) {
+		for (k = 0; k < 2; k++) {
+			if (s1->src[j] != 0 && s1->src[j] == s0->dest[k]) {
+				return SS_SPLIT_DEPENDENT;
+			}
+		}
+	}
+	if (ss_hazard(p, s1, &cause)) {
+		return SS_SPLIT_HAZARD;
+	}
+	return NUM_SS_SPLITS;
+}
+
+/* Write s's results to the register file, HI and LO of state */
+void ss_write_regs(SS_Slot *s, CPU_State *state) {
+	int k;
+
+	for (k = 0; k < 2; k++) {
+		if (s->dest[k] == REG_HI) {
+			state->HI = s->result[k];
+		}
+		else if (s->dest[k] == REG_LO) {
+			state->LO = s->result[k];
+		}
+		else if (s->dest[k] != 0) {
+			state->REGS[s->dest[k]] = s->result[k];
+		}
+	}
+}
+
+/* PC of the oldest instruction in p, which has not retired yet; pc when p is empty */
+uint32_t ss_oldest_pc(SS_Pipeline *p, uint32_t pc) {
+	SS_Slot *latch[4] = { p->MEM_WB, p->EX_MEM, p->ID_EX, p->IF_ID };
+	int i, j;
+
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j < MAX_ISSUE_WIDTH; j++) {
+			if (latch[i][j].valid) {
+				return latch[i][j].pc;
+			}
+		}
+	}
+	return pc;
+}
+
+/* Retire s into the architectural state; FALSE when nothing behind it may go on: */
+/* the program has exited, or a syscall rewrote $v0 under younger instructions      */
+int ss_commit(SS_Slot *s) {
+	ss_write_regs(s, &CURRENT_STATE);
+	TRACE_INSTRUCTION(s->pc);
+	perf_retire(s->ir);
+	profile_retire(s->ir, s->pc);
+	INSTRUCTION_COUNT++;
+	if (s->cls == SS_SYSCALL) {
+		return !syscall_exec(s->result[0], CURRENT_STATE.REGS[4], &CURRENT_STATE.REGS[2]) && RUN_FLAG;
+	}
+	return TRUE;
+}
+
+/***************************************************************/
+/* One cycle of the wide pipeline: each latch moves up to      */
+/* ISSUE_WIDTH instructions, stages run back to front as in     */
+/* handle_pipeline()                                            */
+/***************************************************************/
+void ss_pipeline() {
+	SS_Pipeline *p = &SS_STATE[CURRENT_CORE];
+	perf_counter_t cause = PERF_RAW_STALL;
+	ss_split_t split;
+	uint32_t target;
+	int i, issued = 0, fetched, committed = FALSE;
+
+	SHARED_INC(SS_CYCLES, 1);
+
+	/* WB: retire in order; nothing behind an exit syscall may touch memory */
+	for (i = 0; i < MAX_ISSUE_WIDTH; i++) {
+		if (p->MEM_WB[i].valid) {
+			committed = TRUE;
+			if (!ss_commit(&p->MEM_WB[i])) {
+				if (RUN_FLAG) { // refetch behind the syscall
+					CURRENT_STATE.PC = p->MEM_WB[i].pc + 4;
+				}
+				memset(p, 0, sizeof(*p));
+				NEXT_STATE = CURRENT_STATE;
+				return;
+			}
+		}
+	}
+	if (!committed) {
+		profile_retire(0, 0);
+	}
+
+	/* MEM: at most one slot is a load/store */
+	for (i = 0; i < MAX_ISSUE_WIDTH; i++) {
+		p->MEM_WB[i] = p->EX_MEM[i];
+		if (p->MEM_WB[i].valid) {
+			ss_memory(&p->MEM_WB[i]);
+		}
+	}
+
+	/* EX: a taken branch in slot 0 squashes slot 1 and the front end */
+	p->redirect = FALSE;
+	for (i = 0; i < MAX_ISSUE_WIDTH; i++) {
+		p->EX_MEM[i] = p->ID_EX[i];
+		if (p->redirect) {
+			p->EX_MEM[i].valid = FALSE;
+		}
+		else if (p->EX_MEM[i].valid) {
+			fu_issue(p->EX_MEM[i].ir);
+			if (ss_execute(p, &p->EX_MEM[i], &target)) {
+				CURRENT_STATE.PC = target;
+				p->redirect = TRUE;
+			}
+		}
+	}
+	if (p->redirect) {
+		memset(p->IF_ID, 0, sizeof(p->IF_ID));
+		p->refill = TRUE;
+	}
+
+	/* ID: issue in order from the fetch buffer under the pairing rules */
+	memset(p->ID_EX, 0, sizeof(p->ID_EX));
+	if (p->IF_ID[0].valid) {
+		p->refill = FALSE;
+	}
+	if (p->IF_ID[0].valid && !ss_hazard(p, &p->IF_ID[0], &cause)) {
+		p->ID_EX[0] = p->IF_ID[0];
+		issued = 1;
+		split = ISSUE_WIDTH > 1 ? ss_pair_rule(p, &p->IF_ID[0], &p->IF_ID[1]) : SS_SPLIT_EMPTY;
+		if (split == NUM_SS_SPLITS) {
+			p->ID_EX[1] = p->IF_ID[1];
+			issued = 2;
+		}
+		else {
+			SHARED_INC(SS_SPLITS[split], 1);
+		}
+	}
+	else if (p->IF_ID[0].valid) {
+		PERF_INC(cause);
+	}
+	else if (p->refill) {
+		PERF_INC(PERF_CONTROL_FLUSH);
+	}
+	SHARED_INC(SS_ISSUED[issued], 1);
+	for (i = 0; i + issued < MAX_ISSUE_WIDTH; i++) {
+		p->IF_ID[i] = p->IF_ID[i + issued];
+	}
+	for (; i < MAX_ISSUE_WIDTH; i++) {
+		p->IF_ID[i].valid = FALSE;
+	}
+
+	/* IF: refill the fetch buffer, not in the cycle a redirect resolves, stopping at a breakpoint */
+	if (!p->redirect) {
+		for (fetched = 0, i = 0; i < MAX_ISSUE_WIDTH; i++) {
+			if (p->IF_ID[i].valid) {
+				continue;
+			}
+			if (fetched && BREAK_ACTIVE && break_is_set(CURRENT_STATE.PC)) {
+				break;
+			}
+			if (REUSE_ENABLED) {
+				reuse_access(REUSE_INST, CURRENT_STATE.PC);
+			}
+			ss_decode(&p->IF_ID[i], mem_read_32(CURRENT_STATE.PC), CURRENT_STATE.PC);
+			CURRENT_STATE.PC += 4;
+			fetched++;
+		}
+	}
+	NEXT_STATE = CURRENT_STATE;
+}
+
+/***************************************************************/
+/* Called from core_cycle() with MSHRs: TRUE while an          */
+/* instruction about to enter EX waits on a fill                */
+/***************************************************************/
+int ss_mshr_stall() {
+	SS_Pipeline *p = &SS_STATE[CURRENT_CORE];
+	int i;
+
+	for (i = 0; i < MAX_ISSUE_WIDTH; i++) {
+		if (p->ID_EX[i].valid && mshr_waits(p->ID_EX[i].ir)) {
+			SHARED_INC(MSHR_DEP_CYCLES, 1);
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/***************************************************************/
+/* Called from core_cycle(): TRUE while an instruction about   */
+/* to enter EX waits on the multiplier/divider or HI/LO, with  */
+/* *waiting set to the oldest such instruction                  */
+/***************************************************************/
+int ss_fu_stall(uint32_t *waiting) {
+	SS_Pipeline *p = &SS_STATE[CURRENT_CORE];
+	perf_counter_t cause;
+	int i;
+
+	for (i = 0; i < MAX_ISSUE_WIDTH; i++) {
+		if (p->ID_EX[i].valid && fu_waits(p->ID_EX[i].ir, &cause)) {
+			*waiting = p->ID_EX[i].ir;
+			fu_stalled(p->ID_EX[i].ir, cause);
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/* MSHR cycle by which neither ID/EX slot waits on a fill */
+uint32_t ss_mshr_ready() {
+	SS_Pipeline *p = &SS_STATE[CURRENT_CORE];
+	uint32_t ready = 0, r;
+	int i;
+
+	for (i = 0; i < MAX_ISSUE_WIDTH; i++) {
+		r = p->ID_EX[i].valid ? mshr_ready(p->ID_EX[i].ir) : 0;
+		ready = r > ready ? r : ready;
+	}
+	return ready;
+}
+
+/************************************************************/
+/* Print issue-slot utilization of the wide pipeline        */
+/************************************************************/
+void ss_dump() {
+	double cycles = SS_CYCLES ? (double)SS_CYCLES : 1.0;
+	int i;
+
+	printf("-------------------------------------------------------------\n");
+	printf("Issue width: %u%s\n", ISSUE_WIDTH, ISSUE_WIDTH > 1 ? "" : " (scalar pipeline)");
+	printf("-------------------------------------------------------------\n");
+	printf("cycles\t\t%u\t(%llu advancing)\n", CYCLE_COUNT, (unsigned long long)SS_CYCLES);
+	printf("instructions\t%u\n", INSTRUCTION_COUNT);
+	printf("IPC\t\t%.3f\n", CYCLE_COUNT ? (double)INSTRUCTION_COUNT / CYCLE_COUNT : 0.0);
+	for (i = 0; i <= MAX_ISSUE_WIDTH; i++) {
+		printf("issued %d\t%llu\t%5.1f%%\n", i, (unsigned long long)SS_ISSUED[i], 100.0 * SS_ISSUED[i] / cycles);
+	}
+	printf("dual-issue rate\t%.2f%%\tof advancing cycles\n", 100.0 * SS_ISSUED[MAX_ISSUE_WIDTH] / cycles);
+	printf("-------------------------------------------------------------\n");
+	printf("[Slot 1 empty]\t[Cycles]\n");
+	for (i = 0; i < NUM_SS_SPLITS; i++) {
+		printf("%-16s%llu\n", SS_SPLIT_NAMES[i], (unsigned long long)SS_SPLITS[i]);
+	}
+	printf("-------------------------------------------------------------\n");
+}
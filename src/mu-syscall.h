@@ -0,0 +1,163 @@
+/******************************************************************************/
+/* SYSCALL EMULATION: SPIM SERVICES WITH BUFFERED GUEST I/O                   */
+/******************************************************************************/
+#include <pthread.h>
+
+/* Service numbers, taken from $v0 */
+#define SYS_PRINT_INT     1
+#define SYS_PRINT_STRING  4
+#define SYS_READ_INT      5
+#define SYS_SBRK          9
+#define SYS_EXIT          10
+#define SYS_PRINT_CHAR    11
+#define SYS_EXIT2         17  // exit with the code in $a0
+
+#define SYSCALL_OUT_SIZE    (1 << 20)   // guest output held on the host until a flush
+#define SYSCALL_HEAP_BEGIN  0x10040000  // first sbrk address, as in SPIM
+#define SYSCALL_HEAP_END    0x7FF00000  // leaves 1 MB below MEM_STACK_BEGIN for the stack
+
+char SYSCALL_OUT[SYSCALL_OUT_SIZE];
+uint32_t SYSCALL_OUT_LEN;
+FILE *SYSCALL_OUT_FILE;             // NULL = stdout
+FILE *SYSCALL_IN_FILE;              // NULL = stdin
+uint32_t SYSCALL_BRK = SYSCALL_HEAP_BEGIN;
+int SYSCALL_EXIT_CODE;              // $a0 of the last exit2, 0 after a plain exit
+pthread_mutex_t SYSCALL_LOCK = PTHREAD_MUTEX_INITIALIZER; // cores may retire syscalls on different host threads
+
+/* Statistics, shared by all cores */
+uint64_t SYSCALL_CALLS;
+uint64_t SYSCALL_OUT_BYTES;
+uint64_t SYSCALL_FLUSHES;
+
+/* Write out everything the guest has printed so far */
+void syscall_flush() {
+	if (SYSCALL_OUT_LEN == 0) {
+		return;
+	}
+	fwrite(SYSCALL_OUT, 1, SYSCALL_OUT_LEN, SYSCALL_OUT_FILE ? SYSCALL_OUT_FILE : stdout);
+	fflush(SYSCALL_OUT_FILE ? SYSCALL_OUT_FILE : stdout);
+	SYSCALL_OUT_LEN = 0;
+	SYSCALL_FLUSHES++;
+}
+
+void syscall_reset() {
+	syscall_flush();
+	SYSCALL_BRK = SYSCALL_HEAP_BEGIN;
+	SYSCALL_EXIT_CODE = 0;
+	SYSCALL_CALLS = SYSCALL_OUT_BYTES = SYSCALL_FLUSHES = 0;
+}
+
+/* Send guest output to path instead of stdout */
+int syscall_output(const char *path) {
+	FILE *fp = fopen(path, "w");
+
+	if (fp == NULL) {
+		printf("Error: Can't open guest output file %s\n", path);
+		return FALSE;
+	}
+	syscall_flush();
+	if (SYSCALL_OUT_FILE) {
+		fclose(SYSCALL_OUT_FILE);
+	}
+	SYSCALL_OUT_FILE = fp;
+	return TRUE;
+}
+
+/* Read guest input (read_int) from path instead of stdin */
+int syscall_input(const char *path) {
+	FILE *fp = fopen(path, "r");
+
+	if (fp == NULL) {
+		printf("Error: Can't open guest input file %s\n", path);
+		return FALSE;
+	}
+	if (SYSCALL_IN_FILE) {
+		fclose(SYSCALL_IN_FILE);
+	}
+	SYSCALL_IN_FILE = fp;
+	return TRUE;
+}
+
+void syscall_write(const void *data, uint32_t n) {
+	if (SYSCALL_OUT_LEN + n > SYSCALL_OUT_SIZE) {
+		syscall_flush();
+	}
+	if (n > SYSCALL_OUT_SIZE) { // would not fit even when empty
+		fwrite(data, 1, n, SYSCALL_OUT_FILE ? SYSCALL_OUT_FILE : stdout);
+	}
+	else {
+		memcpy(SYSCALL_OUT + SYSCALL_OUT_LEN, data, n);
+		SYSCALL_OUT_LEN += n;
+	}
+	SYSCALL_OUT_BYTES += n;
+}
+
+/* Append the NUL-terminated guest string at addr straight from simulated memory */
+void syscall_puts(uint32_t addr) {
+	int i;
+
+	for (i = 0; i < NUM_MEM_REGION; i++) {
+		if (addr >= MEM_REGIONS[i].begin && addr <= MEM_REGIONS[i].end) {
+			const char *s = (const char *)MEM_REGIONS[i].mem + (addr - MEM_REGIONS[i].begin);
+			syscall_write(s, strnlen(s, MEM_REGIONS[i].end - addr + 1));
+			return;
+		}
+	}
+}
+
+/***************************************************************/
+/* Called when a SYSCALL retires, with $v0 and $a0 as the      */
+/* instructions before it left them. Returns TRUE when the     */
+/* service wrote *v0 (read_int, sbrk): younger instructions    */
+/* that already read $v0 hold the old value. Exit clears       */
+/* RUN_FLAG                                                    */
+/***************************************************************/
+int syscall_exec(uint32_t service, uint32_t a0, uint32_t *v0) {
+	FILE *in = SYSCALL_IN_FILE ? SYSCALL_IN_FILE : stdin;
+	char text[12];
+	int value, wrote = FALSE;
+	uint32_t size;
+
+	pthread_mutex_lock(&SYSCALL_LOCK);
+	SYSCALL_CALLS++;
+	switch (service) {
+		case SYS_PRINT_INT:
+			syscall_write(text, snprintf(text, sizeof(text), "%d", (int32_t)a0));
+			break;
+		case SYS_PRINT_STRING:
+			syscall_puts(a0);
+			break;
+		case SYS_PRINT_CHAR:
+			text[0] = a0 & 0xFF;
+			syscall_write(text, 1);
+			break;
+		case SYS_READ_INT:
+			syscall_flush(); // show any prompt before blocking
+			*v0 = fscanf(in, "%d", &value) == 1 ? (uint32_t)value : 0;
+			wrote = TRUE;
+			break;
+		case SYS_SBRK:
+			size = (a0 + 3) & ~3;
+			if (size <= SYSCALL_HEAP_END - SYSCALL_BRK) {
+				*v0 = SYSCALL_BRK;
+				SYSCALL_BRK += size;
+			}
+			else {
+				*v0 = 0xFFFFFFFF;
+			}
+			wrote = TRUE;
+			break;
+		case SYS_EXIT2:
+			SYSCALL_EXIT_CODE = a0;
+			// fall through
+		case SYS_EXIT:
+			syscall_flush();
+			RUN_FLAG = FALSE;
+			break;
+		default:
+			TRACE("Unimplemented syscall %u\n", service);
+			break;
+	}
+	pthread_mutex_unlock(&SYSCALL_LOCK);
+	return wrote;
+}
@@ -0,0 +1,197 @@
+/******************************************************************************/
+/* PERIODIC TELEMETRY STREAM                                                  */
+/******************************************************************************/
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define TELEMETRY_RING_SIZE 1024 // power of two
+#define TELEMETRY_OFF       0xFFFFFFFF
+#define TELEMETRY_DEFAULT_INTERVAL 10000 // cycles, when -T is given without -s telemetry=
+
+/* One interval: deltas since the previous snapshot */
+typedef struct Telemetry_Sample_Struct {
+	uint32_t cycle;        // CYCLE_COUNT at the end of the interval
+	uint32_t cycles;
+	uint32_t instructions;
+	uint32_t cache_hits;
+	uint32_t cache_misses;
+	uint64_t counters[NUM_PERF_COUNTERS];
+} Telemetry_Sample;
+
+uint32_t TELEMETRY_INTERVAL;    // cycles per sample (0 = off)
+char TELEMETRY_DEST[108];       // file path, or unix:<socket path>
+uint32_t TELEMETRY_NEXT = TELEMETRY_OFF; // CYCLE_COUNT at which cycle() takes the next sample
+
+/* Single-producer (simulation thread) / single-consumer (writer thread) ring */
+Telemetry_Sample TELEMETRY_RING[TELEMETRY_RING_SIZE];
+atomic_uint TELEMETRY_HEAD;     // next slot the simulator fills
+atomic_uint TELEMETRY_TAIL;     // next slot the writer drains
+atomic_int TELEMETRY_STOP;
+uint64_t TELEMETRY_DROPPED;     // samples lost to a full ring
+
+/* Baseline of the previous sample */
+Telemetry_Sample TELEMETRY_LAST;
+
+pthread_t TELEMETRY_THREAD;
+int TELEMETRY_RUNNING;
+
+// Called from cycle() when CYCLE_COUNT reaches TELEMETRY_NEXT
+#define TELEMETRY_TICK() do { if (CYCLE_COUNT >= TELEMETRY_NEXT) telemetry_sample(); } while (0)
+
+/* Take the baseline from the current counters and schedule the next sample */
+void telemetry_rebase() {
+	TELEMETRY_LAST.cycle = CYCLE_COUNT;
+	TELEMETRY_LAST.instructions = INSTRUCTION_COUNT;
+	TELEMETRY_LAST.cache_hits = cache_hits;
+	TELEMETRY_LAST.cache_misses = cache_misses;
+	memcpy(TELEMETRY_LAST.counters, PERF_COUNTERS, sizeof(PERF_COUNTERS));
+	TELEMETRY_NEXT = TELEMETRY_RUNNING ? CYCLE_COUNT + TELEMETRY_INTERVAL : TELEMETRY_OFF;
+}
+
+/* Push one interval into the ring; never blocks, drops the sample when the writer is behind */
+void telemetry_sample() {
+	unsigned head = atomic_load_explicit(&TELEMETRY_HEAD, memory_order_relaxed);
+	unsigned tail = atomic_load_explicit(&TELEMETRY_TAIL, memory_order_acquire);
+	Telemetry_Sample *s;
+	int i;
+
+	if (CYCLE_COUNT == TELEMETRY_LAST.cycle) {
+		TELEMETRY_NEXT = CYCLE_COUNT + TELEMETRY_INTERVAL;
+		return;
+	}
+	if (head - tail == TELEMETRY_RING_SIZE) {
+		TELEMETRY_DROPPED++;
+	}
+	else {
+		s = &TELEMETRY_RING[head & (TELEMETRY_RING_SIZE - 1)];
+		s->cycle = CYCLE_COUNT;
+		s->cycles = CYCLE_COUNT - TELEMETRY_LAST.cycle;
+		s->instructions = INSTRUCTION_COUNT - TELEMETRY_LAST.instructions;
+		s->cache_hits = cache_hits - TELEMETRY_LAST.cache_hits;
+		s->cache_misses = cache_misses - TELEMETRY_LAST.cache_misses;
+		for (i = 0; i < NUM_PERF_COUNTERS; i++) {
+			s->counters[i] = PERF_COUNTERS[i] - TELEMETRY_LAST.counters[i];
+		}
+		atomic_store_explicit(&TELEMETRY_HEAD, head + 1, memory_order_release);
+	}
+	telemetry_rebase();
+}
+
+/* Open the destination on the writer thread so a slow connect never stalls the simulator */
+FILE *telemetry_open(const char *dest) {
+	struct sockaddr_un addr;
+	int fd;
+
+	if (strncmp(dest, "unix:", 5) != 0) {
+		return strcmp(dest, "-") == 0 ? fdopen(dup(fileno(stderr)), "w") : fopen(dest, "w");
+	}
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return NULL;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, dest + 5, sizeof(addr.sun_path) - 1);
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		close(fd);
+		return NULL;
+	}
+	return fdopen(fd, "w");
+}
+
+/* One JSON object per line */
+void telemetry_write(FILE *fp, Telemetry_Sample *s) {
+	int i;
+	fprintf(fp, "{\"cycle\": %u, \"cycles\": %u, \"instructions\": %u, \"cpi\": %.4f, \"cache_hits\": %u, \"cache_misses\": %u",
+		s->cycle, s->cycles, s->instructions, s->instructions ? (double)s->cycles / s->instructions : 0.0,
+		s->cache_hits, s->cache_misses);
+	for (i = 0; i < NUM_PERF_COUNTERS; i++) {
+		fprintf(fp, ", \"%s\": %llu", PERF_COUNTER_NAMES[i], (unsigned long long)s->counters[i]);
+	}
+	fprintf(fp, "}\n");
+}
+
+/***************************************************************/
+/* Writer thread: drain the ring until stopped and empty       */
+/***************************************************************/
+void *telemetry_writer(void *arg) {
+	struct timespec idle = { 0, 1000000 }; // 1 ms
+	FILE *fp = telemetry_open((const char *)arg);
+	unsigned head, tail;
+	int stop;
+
+	if (fp == NULL) {
+		fprintf(stderr, "Error: Can't open telemetry destination %s\n", (const char *)arg);
+	}
+	while (1) {
+		// read the stop flag first: once it is seen, head already covers the final sample
+		stop = atomic_load(&TELEMETRY_STOP);
+		tail = atomic_load_explicit(&TELEMETRY_TAIL, memory_order_relaxed);
+		head = atomic_load_explicit(&TELEMETRY_HEAD, memory_order_acquire);
+		if (head == tail) {
+			if (stop) {
+				break;
+			}
+			if (fp) {
+				fflush(fp);
+			}
+			nanosleep(&idle, NULL);
+			continue;
+		}
+		for (; tail != head; tail++) {
+			if (fp) {
+				telemetry_write(fp, &TELEMETRY_RING[tail & (TELEMETRY_RING_SIZE - 1)]);
+			}
+		}
+		atomic_store_explicit(&TELEMETRY_TAIL, tail, memory_order_release);
+	}
+	if (fp) {
+		fclose(fp);
+	}
+	return NULL;
+}
+
+/* Flush the partial interval, let the writer drain and join it */
+void telemetry_stop() {
+	if (!TELEMETRY_RUNNING) {
+		return;
+	}
+	telemetry_sample();
+	atomic_store(&TELEMETRY_STOP, 1);
+	pthread_join(TELEMETRY_THREAD, NULL);
+	TELEMETRY_RUNNING = FALSE;
+	TELEMETRY_NEXT = TELEMETRY_OFF;
+	if (TELEMETRY_DROPPED) {
+		fprintf(stderr, "Telemetry: %llu samples dropped, writer could not keep up\n", (unsigned long long)TELEMETRY_DROPPED);
+	}
+}
+
+/***************************************************************/
+/* Stream a sample every <interval> cycles to <dest>            */
+/***************************************************************/
+void telemetry_start(const char *dest, uint32_t interval) {
+	telemetry_stop();
+	if (interval == 0) {
+		return;
+	}
+	if (strlen(dest) >= sizeof(TELEMETRY_DEST)) {
+		printf("Error: telemetry destination too long\n");
+		return;
+	}
+	if (dest != TELEMETRY_DEST) {
+		strcpy(TELEMETRY_DEST, dest);
+	}
+	TELEMETRY_INTERVAL = interval;
+	TELEMETRY_DROPPED = 0;
+	atomic_store(&TELEMETRY_HEAD, 0);
+	atomic_store(&TELEMETRY_TAIL, 0);
+	atomic_store(&TELEMETRY_STOP, 0);
+	if (pthread_create(&TELEMETRY_THREAD, NULL, telemetry_writer, TELEMETRY_DEST) != 0) {
+		printf("Error: Can't start telemetry writer\n");
+		return;
+	}
+	TELEMETRY_RUNNING = TRUE;
+	telemetry_rebase();
+}
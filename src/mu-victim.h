@@ -0,0 +1,163 @@
+/******************************************************************************/
+/* VICTIM CACHE / MISS CACHE BEHIND THE DIRECT-MAPPED L1                      */
+/******************************************************************************/
+#define MAX_VICTIM_ENTRIES 16
+
+typedef enum {
+	VICTIM_CACHE, // holds lines evicted from L1, swapped back on a hit
+	MISS_CACHE    // holds a copy of every line filled on a miss
+} victim_mode_t;
+
+/* One fully-associative entry; line = addr >> 4 */
+typedef struct Victim_Entry_Struct {
+	int valid;
+	uint32_t line;
+	uint32_t words[WORD_PER_BLOCK];
+	uint8_t mesi;
+	uint32_t lru;
+} Victim_Entry;
+
+uint32_t VICTIM_ENTRIES;        // 0 = off
+victim_mode_t VICTIM_MODE;
+Victim_Entry VICTIM[MAX_CORES][MAX_VICTIM_ENTRIES]; // indexed by CURRENT_CORE
+uint32_t VICTIM_CLOCK[MAX_CORES];
+
+/* Statistics, shared by all cores */
+uint64_t VICTIM_PROBES;         // L1 misses that looked in the victim cache
+uint64_t VICTIM_HITS;           // ... and found the line: conflict misses eliminated
+uint64_t VICTIM_INSERTS;
+
+void victim_reset() {
+	memset(VICTIM, 0, sizeof(VICTIM));
+	memset(VICTIM_CLOCK, 0, sizeof(VICTIM_CLOCK));
+	VICTIM_PROBES = VICTIM_HITS = VICTIM_INSERTS = 0;
+}
+
+/* Copy L1 block index into the least recently used entry */
+void victim_insert(uint32_t index) {
+	Victim_Entry *v = VICTIM[CURRENT_CORE], *slot = &v[0];
+	CacheBlock *block = &L1Cache.blocks[index];
+	uint32_t line = (block->tag << 4) | index, i;
+
+	for (i = 0; i < VICTIM_ENTRIES; i++) {
+		if (v[i].valid && v[i].line == line) { // already held: refresh it
+			slot = &v[i];
+			break;
+		}
+		if (!v[i].valid || v[i].lru < slot->lru) {
+			slot = &v[i];
+		}
+	}
+	slot->valid = TRUE;
+	slot->line = line;
+	memcpy(slot->words, block->words, sizeof(block->words));
+	slot->mesi = MESI_STATE[index];
+	slot->lru = ++VICTIM_CLOCK[CURRENT_CORE];
+	SHARED_INC(VICTIM_INSERTS, 1);
+}
+
+// Called before an L1 fill overwrites block index
+void victim_evict(uint32_t index) {
+	if (VICTIM_MODE == VICTIM_CACHE && L1Cache.blocks[index].valid) {
+		victim_insert(index);
+	}
+}
+
+// Called after an L1 miss filled block index from memory
+void victim_fill(uint32_t index) {
+	if (VICTIM_MODE == MISS_CACHE) {
+		victim_insert(index);
+	}
+}
+
+// Called on every store to addr: a copy held behind L1 takes the new word
+void victim_write(uint32_t addr, uint32_t value) {
+	Victim_Entry *v = VICTIM[CURRENT_CORE];
+	uint32_t i;
+
+	for (i = 0; i < VICTIM_ENTRIES; i++) {
+		if (v[i].valid && v[i].line == addr >> 4) {
+			v[i].words[(addr & 0x0000000C) >> 2] = value;
+		}
+	}
+}
+
+/***************************************************************/
+/* Called from cache_isHit() on an L1 miss: TRUE when the line */
+/* was found and moved into L1                                 */
+/***************************************************************/
+int victim_lookup(uint32_t addr) {
+	Victim_Entry *v = VICTIM[CURRENT_CORE], tmp;
+	uint32_t line = addr >> 4, index = (addr & 0x000000F0) >> 4, i;
+	CacheBlock *block = &L1Cache.blocks[index];
+
+	SHARED_INC(VICTIM_PROBES, 1);
+	for (i = 0; i < VICTIM_ENTRIES; i++) {
+		if (v[i].valid && v[i].line == line) {
+			break;
+		}
+	}
+	if (i == VICTIM_ENTRIES) {
+		return FALSE;
+	}
+	tmp = v[i];
+	if (VICTIM_MODE == VICTIM_CACHE) { // swap: the displaced L1 line takes the entry
+		v[i].valid = block->valid;
+		v[i].line = (block->tag << 4) | index;
+		memcpy(v[i].words, block->words, sizeof(block->words));
+		v[i].mesi = MESI_STATE[index];
+		v[i].lru = ++VICTIM_CLOCK[CURRENT_CORE];
+	}
+	else { // the line now lives in L1; a second copy could only go stale
+		v[i].valid = FALSE;
+	}
+	tags_lock();
+	block->valid = 1;
+	block->tag = tmp.line >> 4;
+	MESI_STATE[index] = tmp.mesi;
+	tags_unlock();
+	memcpy(block->words, tmp.words, sizeof(block->words));
+	MEM_STALL_CYCLES += CACHE_MISS_PENALTY > 0; // one cycle to swap, when memory is not ideal
+	SHARED_INC(VICTIM_HITS, 1);
+	return TRUE;
+}
+
+/* Snoop core's victim entries; TRUE when it held the line */
+int victim_snoop(int core, bus_op_t op, uint32_t addr) {
+	Victim_Entry *v = VICTIM[core];
+	uint32_t i;
+
+	for (i = 0; i < VICTIM_ENTRIES; i++) {
+		if (v[i].valid && v[i].line == addr >> 4 && v[i].mesi != MESI_I) {
+			if (v[i].mesi == MESI_M) {
+				CORE_STATS[core].flushes++;
+			}
+			if (op == BUS_RD) {
+				v[i].mesi = MESI_S;
+			}
+			else {
+				v[i].valid = FALSE;
+				v[i].mesi = MESI_I;
+			}
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/************************************************************/
+/* Print victim/miss cache statistics                       */
+/************************************************************/
+void victim_dump() {
+	printf("-------------------------------------------------------------\n");
+	printf("%s: %u entries, fully associative\n", VICTIM_MODE == VICTIM_CACHE ? "Victim cache" : "Miss cache", VICTIM_ENTRIES);
+	printf("-------------------------------------------------------------\n");
+	printf("probes\t\t%llu\tL1 misses\n", (unsigned long long)VICTIM_PROBES);
+	printf("hits\t\t%llu\tconflict misses eliminated\n", (unsigned long long)VICTIM_HITS);
+	printf("inserts\t\t%llu\n", (unsigned long long)VICTIM_INSERTS);
+	printf("hit rate\t%.2f%%\n", VICTIM_PROBES ? 100.0 * VICTIM_HITS / VICTIM_PROBES : 0.0);
+	printf("L1 miss rate\t%.2f%% -> %.2f%%\n",
+		cache_hits + cache_misses ? 100.0 * (cache_misses + VICTIM_HITS) / (cache_hits + cache_misses) : 0.0,
+		cache_hits + cache_misses ? 100.0 * cache_misses / (cache_hits + cache_misses) : 0.0);
+	printf("-------------------------------------------------------------\n");
+}